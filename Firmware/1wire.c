@@ -56,10 +56,12 @@
 
 #include "base.h"
 #include "binary_io.h"
+#include "core.h"
 #include "proc_menu.h"
 
 extern mode_configuration_t mode_configuration;
 extern command_t last_command;
+extern bus_pirate_configuration_t bus_pirate_configuration;
 
 /**
  * @brief The maximum size of the saved devices roster, in entries.
@@ -112,6 +114,115 @@ extern command_t last_command;
  */
 #define DS2431 0x2D
 
+/**
+ * @brief Standard bus speed identifier, as stored in mode_configuration.speed.
+ */
+#define ONEWIRE_SPEED_STANDARD 0
+
+/**
+ * @brief Overdrive bus speed identifier, as stored in mode_configuration.speed.
+ */
+#define ONEWIRE_SPEED_OVERDRIVE 1
+
+/**
+ * @brief Thermometer "Convert T" function command.
+ */
+#define THERMOMETER_CONVERT_T 0x44
+
+/**
+ * @brief Thermometer "Read Scratchpad" function command.
+ */
+#define THERMOMETER_READ_SCRATCHPAD 0xBE
+
+/**
+ * @brief Size of a DS18x20-style thermometer scratchpad, CRC8 included.
+ */
+#define THERMOMETER_SCRATCHPAD_SIZE 9
+
+/**
+ * @brief How many milliseconds to wait at most for a temperature conversion
+ * to complete when polling the bus.
+ *
+ * The bus is polled once per millisecond, so the wait does not depend on the
+ * bus speed.  This is more than the 750ms needed for a 12-bit conversion.
+ */
+#define THERMOMETER_CONVERSION_TIMEOUT_MS 1000
+
+/**
+ * @brief Maximum number of sensors a single sensor sweep can handle.
+ *
+ * Both the ROM identifiers sent by the host and the results are kept in the
+ * terminal buffer at the same time.
+ */
+#define SENSOR_SWEEP_MAXIMUM_SENSORS                                           \
+  (BP_TERMINAL_BUFFER_SIZE /                                                   \
+   (ROM_BYTES_SIZE + 1 + THERMOMETER_SCRATCHPAD_SIZE))
+
+#if SENSOR_SWEEP_MAXIMUM_SENSORS > 255
+#undef SENSOR_SWEEP_MAXIMUM_SENSORS
+#define SENSOR_SWEEP_MAXIMUM_SENSORS 255
+#endif /* SENSOR_SWEEP_MAXIMUM_SENSORS > 255 */
+
+/**
+ * @brief Memory device "Write Scratchpad" function command.
+ */
+#define MEMORY_WRITE_SCRATCHPAD 0x0F
+
+/**
+ * @brief Memory device "Read Scratchpad" function command.
+ */
+#define MEMORY_READ_SCRATCHPAD 0xAA
+
+/**
+ * @brief Memory device "Copy Scratchpad" function command.
+ */
+#define MEMORY_COPY_SCRATCHPAD 0x55
+
+/**
+ * @brief Memory device "Read Memory" function command.
+ */
+#define MEMORY_READ_MEMORY 0xF0
+
+/**
+ * @brief Largest scratchpad size handled by the memory page write command.
+ *
+ * DS2431 parts have an 8 bytes scratchpad, DS28EC20 parts have a 32 bytes one.
+ */
+#define MEMORY_MAXIMUM_SCRATCHPAD_SIZE 32
+
+/**
+ * @brief Pattern sent by memory devices once a scratchpad copy succeeded.
+ */
+#define MEMORY_COPY_DONE_PATTERN 0xAA
+
+/**
+ * @brief Partial flag bit in the scratchpad E/S byte.
+ */
+#define MEMORY_ES_PARTIAL_FLAG 0x20
+
+/**
+ * @brief Time to wait for a memory device to copy its scratchpad, in ms.
+ *
+ * Both DS2431 and DS28EC20 need up to 10ms, a small margin is added on top.
+ */
+#define MEMORY_PROGRAMMING_TIME 13
+
+/**
+ * @brief CRC16 value obtained by running the CRC over a data block followed by
+ * the inverted CRC16 bytes sent by the device.
+ */
+#define CRC16_RESIDUE 0xB001
+
+/**
+ * @brief Device addressing byte value selecting all devices (Skip ROM).
+ */
+#define ADDRESSING_SKIP_ROM 0x00
+
+/**
+ * @brief Device addressing byte value selecting one device (Match ROM).
+ */
+#define ADDRESSING_MATCH_ROM 0x01
+
 /**
  * @brief Binary I/O 1-Wire Action command.
  *
@@ -126,14 +237,14 @@ extern command_t last_command;
  * * `0b0000` : BINARY_IO_ONEWIRE_ACTION_EXIT.
  * * `0b0001` : BINARY_IO_ONEWIRE_ACTION_VERSION_STRING.
  * * `0b0010` : BINARY_IO_ONEWIRE_ACTION_BUS_RESET.
- * * `0b0011` : Reserved.
+ * * `0b0011` : BINARY_IO_ONEWIRE_ACTION_OVERDRIVE_SKIP_ROM.
  * * `0b0100` : BINARY_IO_ONEWIRE_ACTION_READ_BYTE.
- * * `0b0101` : Reserved.
- * * `0b0110` : Reserved.
- * * `0b0111` : Reserved.
+ * * `0b0101` : BINARY_IO_ONEWIRE_ACTION_OVERDRIVE_MATCH_ROM.
+ * * `0b0110` : BINARY_IO_ONEWIRE_ACTION_SENSOR_SWEEP.
+ * * `0b0111` : BINARY_IO_ONEWIRE_ACTION_MEMORY_READ.
  * * `0b1000` : BINARY_IO_ONEWIRE_ACTION_ROM_SEARCH_MACRO.
  * * `0b1001` : BINARY_IO_ONEWIRE_ACTION_ALARM_SEARCH_MACRO.
- * * `0b1010` : Reserved.
+ * * `0b1010` : BINARY_IO_ONEWIRE_ACTION_MEMORY_WRITE_PAGE.
  * * `0b1011` : Reserved.
  * * `0b1100` : Reserved.
  * * `0b1101` : Reserved.
@@ -144,9 +255,14 @@ extern command_t last_command;
  * @see BINARY_IO_ONEWIRE_ACTION_EXIT
  * @see BINARY_IO_ONEWIRE_ACTION_VERSION_STRING
  * @see BINARY_IO_ONEWIRE_ACTION_BUS_RESET
+ * @see BINARY_IO_ONEWIRE_ACTION_OVERDRIVE_SKIP_ROM
  * @see BINARY_IO_ONEWIRE_ACTION_READ_BYTE
+ * @see BINARY_IO_ONEWIRE_ACTION_OVERDRIVE_MATCH_ROM
+ * @see BINARY_IO_ONEWIRE_ACTION_SENSOR_SWEEP
+ * @see BINARY_IO_ONEWIRE_ACTION_MEMORY_READ
  * @see BINARY_IO_ONEWIRE_ACTION_ROM_SEARCH_MACRO
  * @see BINARY_IO_ONEWIRE_ACTION_ALARM_SEARCH_MACRO
+ * @see BINARY_IO_ONEWIRE_ACTION_MEMORY_WRITE_PAGE
  */
 #define BINARY_IO_ONEWIRE_COMMAND_ACTION 0x00
 
@@ -333,6 +449,31 @@ extern command_t last_command;
  */
 #define BINARY_IO_ONEWIRE_ACTION_BUS_RESET 0x02
 
+/**
+ * @brief Binary I/O 1-Wire Action command to switch all overdrive-capable
+ * devices to overdrive speed.
+ *
+ * The board performs a standard speed bus reset, sends the "Overdrive Skip ROM"
+ * (`0x3C`) command at standard speed, and then switches its own bus timings to
+ * overdrive speed.  If no device answered the bus reset the bus stays at
+ * standard speed and a FAILURE value is returned instead.
+ *
+ * Current format is as follows:
+ *
+ * <table><tr><th>Bits</th><th>Meaning</th></tr>
+ * <tr><td>`7:4`</td><td>Command type, set to `0b0000` (ACTION).</td></tr>
+ * <tr><td>`3:0`</td><td>Action type, set to `0b0011` (OVERDRIVE_SKIP_ROM).</td>
+ * </tr></table>
+ *
+ * Interaction flow is as follows:
+ *
+ * <table><tr><td>PC</td><td>&rarr;</td><td>Bus Pirate</td>
+ * <td>`0b00000011`</td></tr>
+ * <tr><td>PC</td><td>&larr;</td><td>Bus Pirate</td>
+ * <td>`0b00000001` (SUCCESS) or `0b00000000` (FAILURE).</td></tr></table>
+ */
+#define BINARY_IO_ONEWIRE_ACTION_OVERDRIVE_SKIP_ROM 0x03
+
 /**
  * @brief Binary I/O 1-Wire Action command to read a byte from the bus.
  *
@@ -353,6 +494,120 @@ extern command_t last_command;
  */
 #define BINARY_IO_ONEWIRE_ACTION_READ_BYTE 0x04
 
+/**
+ * @brief Binary I/O 1-Wire Action command to address a single device and
+ * switch it to overdrive speed.
+ *
+ * The board reads the 8 ROM bytes of the device to address from the serial
+ * port, performs a standard speed bus reset, sends the "Overdrive Match ROM"
+ * (`0x69`) command at standard speed, and then sends the ROM bytes at
+ * overdrive speed.  Bus timings are left at overdrive speed afterwards.  If no
+ * device answered the bus reset the bus stays at standard speed and a FAILURE
+ * value is returned instead.
+ *
+ * Current format is as follows:
+ *
+ * <table><tr><th>Bits</th><th>Meaning</th></tr>
+ * <tr><td>`7:4`</td><td>Command type, set to `0b0000` (ACTION).</td></tr>
+ * <tr><td>`3:0`</td><td>Action type, set to `0b0101` (OVERDRIVE_MATCH_ROM).
+ * </td></tr></table>
+ *
+ * Interaction flow is as follows:
+ *
+ * <table><tr><td>PC</td><td>&rarr;</td><td>Bus Pirate</td>
+ * <td>`0b00000101`</td></tr>
+ * <tr><td>PC</td><td>&rarr;</td><td>Bus Pirate</td>
+ * <td>ROM bytes #0 to #7.</td></tr>
+ * <tr><td>PC</td><td>&larr;</td><td>Bus Pirate</td>
+ * <td>`0b00000001` (SUCCESS) or `0b00000000` (FAILURE).</td></tr></table>
+ */
+#define BINARY_IO_ONEWIRE_ACTION_OVERDRIVE_MATCH_ROM 0x05
+
+/**
+ * @brief Binary I/O 1-Wire Action command to read a batch of thermometers.
+ *
+ * Once the sensors count is acknowledged, the board reads the conversion wait
+ * mode and the ROM identifiers of all the sensors to read.  Then it starts a
+ * temperature conversion on every device at once (Skip ROM, Convert T), waits
+ * for the conversion to complete, and reads the scratchpad of every listed
+ * sensor in turn (Match ROM, Read Scratchpad), checking its CRC8.
+ *
+ * The wait mode byte can either be `0x00`, to poll the bus until all devices
+ * have completed the conversion (externally powered sensors only, up to about
+ * one second), or the time to wait in units of 10 milliseconds (for parasite
+ * powered sensors, that cannot signal the conversion status).  If no device
+ * answers the conversion start, or polling times out, every sensor is
+ * reported as FAILURE without reading its scratchpad.
+ *
+ * Results are sent back all at once, in the same order as the ROM identifiers
+ * were given, as a status byte (SUCCESS if the sensor answered and the
+ * scratchpad CRC8 is valid, FAILURE otherwise) followed by the nine scratchpad
+ * bytes read from the device.
+ *
+ * Current format is as follows:
+ *
+ * <table><tr><th>Bits</th><th>Meaning</th></tr>
+ * <tr><td>`7:4`</td><td>Command type, set to `0b0000` (ACTION).</td></tr>
+ * <tr><td>`3:0`</td><td>Action type, set to `0b0110` (SENSOR_SWEEP).</td></tr>
+ * </table>
+ *
+ * Interaction flow is as follows:
+ *
+ * <table><tr><td>PC</td><td>&rarr;</td><td>Bus Pirate</td>
+ * <td>`0b00000110`</td></tr>
+ * <tr><td>PC</td><td>&rarr;</td><td>Bus Pirate</td>
+ * <td>Sensors count, from 1 to SENSOR_SWEEP_MAXIMUM_SENSORS.</td></tr>
+ * <tr><td>PC</td><td>&larr;</td><td>Bus Pirate</td>
+ * <td>`0b00000001` (SUCCESS), or `0b00000000` (FAILURE) if the count is out of
+ * range, in which case the command ends here.</td></tr>
+ * <tr><td>PC</td><td>&rarr;</td><td>Bus Pirate</td>
+ * <td>Conversion wait mode.</td></tr>
+ * <tr><td>PC</td><td>&rarr;</td><td>Bus Pirate</td>
+ * <td>ROM bytes #0 to #7 for every sensor.</td></tr>
+ * <tr><td>PC</td><td>&larr;</td><td>Bus Pirate</td>
+ * <td>Status byte and scratchpad bytes #0 to #8 for every sensor.</td></tr>
+ * </table>
+ */
+#define BINARY_IO_ONEWIRE_ACTION_SENSOR_SWEEP 0x06
+
+/**
+ * @brief Binary I/O 1-Wire Action command to read a block of device memory.
+ *
+ * The board selects the device to read from, sends the "Read Memory" (`0xF0`)
+ * command with the given starting address, reads the requested amount of bytes
+ * and then sends them back all at once.
+ *
+ * The addressing byte is either `0x00` to talk to the only device on the bus
+ * (Skip ROM), or `0x01` followed by the 8 ROM bytes of the device to talk to
+ * (Match ROM).  Both the starting address and the length are sent MSB first,
+ * the length cannot exceed BP_TERMINAL_BUFFER_SIZE.
+ *
+ * Current format is as follows:
+ *
+ * <table><tr><th>Bits</th><th>Meaning</th></tr>
+ * <tr><td>`7:4`</td><td>Command type, set to `0b0000` (ACTION).</td></tr>
+ * <tr><td>`3:0`</td><td>Action type, set to `0b0111` (MEMORY_READ).</td></tr>
+ * </table>
+ *
+ * Interaction flow is as follows:
+ *
+ * <table><tr><td>PC</td><td>&rarr;</td><td>Bus Pirate</td>
+ * <td>`0b00000111`</td></tr>
+ * <tr><td>PC</td><td>&rarr;</td><td>Bus Pirate</td>
+ * <td>Addressing byte, and ROM bytes #0 to #7 if needed.</td></tr>
+ * <tr><td>PC</td><td>&rarr;</td><td>Bus Pirate</td>
+ * <td>Starting address, 2 bytes.</td></tr>
+ * <tr><td>PC</td><td>&rarr;</td><td>Bus Pirate</td>
+ * <td>Length, 2 bytes.</td></tr>
+ * <tr><td>PC</td><td>&larr;</td><td>Bus Pirate</td>
+ * <td>`0b00000001` (SUCCESS), or `0b00000000` (FAILURE) if the length is out
+ * of range or no device answered, in which case the command ends here.</td>
+ * </tr>
+ * <tr><td>PC</td><td>&larr;</td><td>Bus Pirate</td>
+ * <td>Memory bytes.</td></tr></table>
+ */
+#define BINARY_IO_ONEWIRE_ACTION_MEMORY_READ 0x07
+
 /**
  * @brief Binary I/O 1-Wire Action command to invoke the "ROM search" macro.
  *
@@ -429,6 +684,50 @@ extern command_t last_command;
  */
 #define BINARY_IO_ONEWIRE_ACTION_ALARM_SEARCH_MACRO 0x09
 
+/**
+ * @brief Binary I/O 1-Wire Action command to write and verify a memory page.
+ *
+ * The board selects the device to write to and performs the full memory write
+ * sequence on its own: "Write Scratchpad" (`0x0F`) checking the CRC16 sent
+ * back by the device, "Read Scratchpad" (`0xAA`) checking the CRC16, address,
+ * and data read back, and finally "Copy Scratchpad" (`0x55`) with the
+ * authorisation bytes, waiting for the copy to complete and checking the
+ * completion pattern.  A single SUCCESS value is returned only if every step
+ * went fine, a FAILURE value otherwise.
+ *
+ * The addressing byte is either `0x00` to talk to the only device on the bus
+ * (Skip ROM), or `0x01` followed by the 8 ROM bytes of the device to talk to
+ * (Match ROM).  The target address is sent MSB first and must be aligned to
+ * the scratchpad size, which is 8 bytes for DS2431 and 32 bytes for DS28EC20
+ * parts (up to MEMORY_MAXIMUM_SCRATCHPAD_SIZE).
+ *
+ * Current format is as follows:
+ *
+ * <table><tr><th>Bits</th><th>Meaning</th></tr>
+ * <tr><td>`7:4`</td><td>Command type, set to `0b0000` (ACTION).</td></tr>
+ * <tr><td>`3:0`</td><td>Action type, set to `0b1010` (MEMORY_WRITE_PAGE).</td>
+ * </tr></table>
+ *
+ * Interaction flow is as follows:
+ *
+ * <table><tr><td>PC</td><td>&rarr;</td><td>Bus Pirate</td>
+ * <td>`0b00001010`</td></tr>
+ * <tr><td>PC</td><td>&rarr;</td><td>Bus Pirate</td>
+ * <td>Addressing byte, and ROM bytes #0 to #7 if needed.</td></tr>
+ * <tr><td>PC</td><td>&rarr;</td><td>Bus Pirate</td>
+ * <td>Target address, 2 bytes.</td></tr>
+ * <tr><td>PC</td><td>&rarr;</td><td>Bus Pirate</td>
+ * <td>Scratchpad size, 1 byte.</td></tr>
+ * <tr><td>PC</td><td>&larr;</td><td>Bus Pirate</td>
+ * <td>`0b00000001` (SUCCESS), or `0b00000000` (FAILURE) if the size is out of
+ * range, in which case the command ends here.</td></tr>
+ * <tr><td>PC</td><td>&rarr;</td><td>Bus Pirate</td>
+ * <td>Page data bytes.</td></tr>
+ * <tr><td>PC</td><td>&larr;</td><td>Bus Pirate</td>
+ * <td>`0b00000001` (SUCCESS) or `0b00000000` (FAILURE).</td></tr></table>
+ */
+#define BINARY_IO_ONEWIRE_ACTION_MEMORY_WRITE_PAGE 0x0A
+
 /**
  * @brief 1-Wire protocol macro identifiers.
  */
@@ -439,9 +738,15 @@ typedef enum {
   /** Identifier for the "Read ROM" macro entry. */
   MACRO_READ_ROM = 0x33,
 
+  /** Identifier for the "Overdrive Skip ROM" macro entry. */
+  MACRO_OVERDRIVE_SKIP_ROM = 0x3C,
+
   /** Identifier for the "Match ROM" macro entry. */
   MACRO_MATCH_ROM = 0x55,
 
+  /** Identifier for the "Overdrive Match ROM" macro entry. */
+  MACRO_OVERDRIVE_MATCH_ROM = 0x69,
+
   /** Identifier for the "Skip ROM" macro entry. */
   MACRO_SKIP_ROM = 0xCC,
 
@@ -602,6 +907,82 @@ static onewire_state_t onewire_state = {.command_byte = MACRO_SEARCH_ROM};
  */
 static onewire_bus_reset_result_t perform_bus_reset(void);
 
+/**
+ * @brief Prints the outcome of a bus reset on the terminal.
+ *
+ * @param[in] reset_result the result of the bus reset to describe.
+ */
+static void print_bus_reset_result(
+    const onewire_bus_reset_result_t reset_result);
+
+/**
+ * @brief Switches the bus to overdrive speed using the given ROM command.
+ *
+ * A standard speed bus reset is performed first, then the given command is sent
+ * at standard speed.  If any device answered the reset, the bus timings are
+ * switched to overdrive speed.
+ *
+ * @param[in] command either MACRO_OVERDRIVE_SKIP_ROM or
+ * MACRO_OVERDRIVE_MATCH_ROM.
+ *
+ * @return the result of the standard speed bus reset.
+ */
+static onewire_bus_reset_result_t enter_overdrive_speed(const uint8_t command);
+
+/**
+ * @brief Performs a batched temperature conversion and scratchpad read.
+ *
+ * @param[in] sensors how many ROM identifiers are stored at the beginning of
+ * the terminal buffer.
+ * @param[in] wait_mode 0 to poll the bus for conversion completion, or the
+ * time to wait in units of 10 milliseconds.
+ *
+ * @see BINARY_IO_ONEWIRE_ACTION_SENSOR_SWEEP
+ */
+static void perform_sensor_sweep(const uint8_t sensors,
+                                 const uint8_t wait_mode);
+
+/**
+ * @brief Resets the bus and selects either all devices or a single one.
+ *
+ * @param[in] rom_address the ROM address of the device to select with a
+ * Match ROM command, or NULL to select all devices with a Skip ROM command.
+ *
+ * @return true if any device answered the bus reset, false otherwise.
+ */
+static bool select_device(const uint8_t *rom_address);
+
+/**
+ * @brief Reads the device addressing information from the serial port.
+ *
+ * @param[out] rom_address the buffer to store the ROM address into.
+ * @param[out] selection set to rom_address if a single device has to be
+ * selected, NULL if all devices have to be selected.
+ *
+ * @return true if the addressing byte was ADDRESSING_SKIP_ROM or
+ * ADDRESSING_MATCH_ROM, false otherwise.
+ *
+ * @see BINARY_IO_ONEWIRE_ACTION_MEMORY_READ
+ */
+static bool read_device_addressing(uint8_t *rom_address,
+                                   const uint8_t **selection);
+
+/**
+ * @brief Writes a memory page through the scratchpad, verifying every step.
+ *
+ * @param[in] rom_address the device to talk to, or NULL for all devices.
+ * @param[in] address the target memory address.
+ * @param[in] data the page data to write.
+ * @param[in] length the scratchpad size, in bytes.
+ *
+ * @return true if the page was written and verified, false otherwise.
+ *
+ * @see BINARY_IO_ONEWIRE_ACTION_MEMORY_WRITE_PAGE
+ */
+static bool write_memory_page(const uint8_t *rom_address,
+                              const uint16_t address, const uint8_t *data,
+                              const uint8_t length);
+
 /**
  * @brief 1-wire protocol precalculated CRC table.
  *
@@ -631,6 +1012,16 @@ static const uint8_t CRC_TABLE[] = {
     0x74, 0x2A, 0xC8, 0x96, 0x15, 0x4B, 0xA9, 0xF7, 0xB6, 0xE8, 0x0A, 0x54,
     0xD7, 0x89, 0x6B, 0x35};
 
+/**
+ * @brief 1-wire protocol precalculated CRC16 nibble table.
+ *
+ * Covers the x^16 + x^15 + x^2 + 1 polynomial used by memory devices, in its
+ * bit-reversed form, four bits at a time to keep the table small.
+ */
+static const uint16_t CRC16_TABLE[] = {
+    0x0000, 0xCC01, 0xD801, 0x1400, 0xF001, 0x3C00, 0x2800, 0xE401,
+    0xA001, 0x6C00, 0x7800, 0xB401, 0x5000, 0x9C01, 0x8801, 0x4400};
+
 /**
  * @brief Updates the internal CRC8 variable with the given data value.
  *
@@ -639,6 +1030,15 @@ static const uint8_t CRC_TABLE[] = {
  */
 static uint8_t update_crc8(const uint8_t value);
 
+/**
+ * @brief Updates the given CRC16 value with the given data value.
+ *
+ * @param[in] crc the CRC16 value to update.
+ * @param[in] value the new byte to update the CRC16 value with.
+ * @return the updated CRC16 value.
+ */
+static uint16_t update_crc16(uint16_t crc, const uint8_t value);
+
 /**
  * @brief Looks up the given model identifier.
  *
@@ -899,6 +1299,32 @@ void onewire_run_macro(const uint16_t macro) {
     ONEWIRE_WRITE_BYTE(MACRO_MATCH_ROM);
     break;
 
+  case MACRO_OVERDRIVE_SKIP_ROM:
+  case MACRO_OVERDRIVE_MATCH_ROM: {
+    onewire_bus_reset_result_t reset_result;
+
+    /* Overdrive is entered from standard speed only. */
+    mode_configuration.speed = ONEWIRE_SPEED_STANDARD;
+    reset_result = perform_bus_reset();
+    print_bus_reset_result(reset_result);
+
+    /* Without a presence pulse no device can follow, stay at standard speed. */
+    if (reset_result != ONEWIRE_BUS_RESET_OK) {
+      break;
+    }
+
+    if (macro_id == MACRO_OVERDRIVE_SKIP_ROM) {
+      MSG_1WIRE_OVERDRIVE_SKIP_ROM_MACRO_NAME;
+    } else {
+      MSG_1WIRE_OVERDRIVE_MATCH_ROM_MACRO_NAME;
+    }
+    ONEWIRE_WRITE_BYTE(macro_id);
+
+    /* Any following ROM address or command byte goes out in overdrive. */
+    mode_configuration.speed = ONEWIRE_SPEED_OVERDRIVE;
+    break;
+  }
+
   case MACRO_SKIP_ROM:
     onewire_reset();
     MSG_1WIRE_SKIP_ROM_MACRO_NAME;
@@ -913,10 +1339,9 @@ void onewire_run_macro(const uint16_t macro) {
 
 void onewire_pins_state(void) { MSG_1WIRE_PINS_STATE; }
 
-void onewire_reset(void) {
-  onewire_bus_reset_result_t reset_result;
+void onewire_reset(void) { print_bus_reset_result(perform_bus_reset()); }
 
-  reset_result = perform_bus_reset();
+void print_bus_reset_result(const onewire_bus_reset_result_t reset_result) {
   MSG_1WIRE_BUS_RESET;
 
   if (reset_result == ONEWIRE_BUS_RESET_OK) {
@@ -942,9 +1367,9 @@ onewire_bus_reset_result_t perform_bus_reset(void) {
   /* Pull the bus line LOW. */
 
   ONEWIRE_DATA_DIRECTION = INPUT;
-  if (mode_configuration.speed == 1) {
+  if (mode_configuration.speed == ONEWIRE_SPEED_OVERDRIVE) {
     /* AN126: Parameter G */
-    bp_delay_us(1);
+    bp_delay_us(2);
   }
   ONEWIRE_DATA_LINE = LOW;
   ONEWIRE_DATA_DIRECTION = OUTPUT;
@@ -954,7 +1379,7 @@ onewire_bus_reset_result_t perform_bus_reset(void) {
    * reading the line in standard mode, or no more than 70us for overdrive.
    * AN126: Parameter H
    */
-  if (mode_configuration.speed == 0) {
+  if (mode_configuration.speed == ONEWIRE_SPEED_STANDARD) {
     bp_delay_us(500);
   } else {
     bp_delay_us(70);
@@ -963,10 +1388,10 @@ onewire_bus_reset_result_t perform_bus_reset(void) {
   /* Release the bus. */
   ONEWIRE_DATA_DIRECTION = INPUT;
   /* AN126: Parameter I */
-  if (mode_configuration.speed == 0) {
+  if (mode_configuration.speed == ONEWIRE_SPEED_STANDARD) {
     bp_delay_us(65);
   } else {
-    bp_delay_us(6);
+    bp_delay_us(8);
   }
 
   /* Read the data line. */
@@ -976,10 +1401,10 @@ onewire_bus_reset_result_t perform_bus_reset(void) {
   }
 
   /* AN126: Parameter J */
-  if (mode_configuration.speed == 0) {
+  if (mode_configuration.speed == ONEWIRE_SPEED_STANDARD) {
     bp_delay_us(500);
   } else {
-    bp_delay_us(32);
+    bp_delay_us(40);
   }
 
   /* Read the data line. */
@@ -991,6 +1416,199 @@ onewire_bus_reset_result_t perform_bus_reset(void) {
   return result;
 }
 
+onewire_bus_reset_result_t enter_overdrive_speed(const uint8_t command) {
+  onewire_bus_reset_result_t result;
+
+  /* A standard speed reset brings every device back to standard speed. */
+  mode_configuration.speed = ONEWIRE_SPEED_STANDARD;
+  result = perform_bus_reset();
+  if (result == ONEWIRE_BUS_RESET_OK) {
+    ONEWIRE_WRITE_BYTE(command);
+    mode_configuration.speed = ONEWIRE_SPEED_OVERDRIVE;
+  }
+
+  return result;
+}
+
+void perform_sensor_sweep(const uint8_t sensors, const uint8_t wait_mode) {
+  uint8_t *rom_address;
+  uint8_t *result;
+  uint8_t sensor;
+  size_t index;
+  bool converted;
+
+  /* Start a conversion on all devices at once. */
+
+  converted = false;
+  if (select_device(NULL)) {
+    ONEWIRE_WRITE_BYTE(THERMOMETER_CONVERT_T);
+
+    if (wait_mode == 0) {
+      /* Devices keep reading zeroes until the conversion is complete. */
+      for (index = 0; index < THERMOMETER_CONVERSION_TIMEOUT_MS; index++) {
+        if (ONEWIRE_READ_BIT()) {
+          converted = true;
+          break;
+        }
+        bp_delay_ms(1);
+      }
+    } else {
+      for (index = 0; index < wait_mode; index++) {
+        bp_delay_ms(10);
+      }
+      converted = true;
+    }
+  }
+
+  /* Results go right after the ROM identifiers. */
+
+  rom_address = bus_pirate_configuration.terminal_input;
+  result = bus_pirate_configuration.terminal_input + (sensors * ROM_BYTES_SIZE);
+
+  for (sensor = 0; sensor < sensors; sensor++) {
+    *result = BP_BINARY_IO_RESULT_FAILURE;
+
+    /* Scratchpads hold an older reading if the conversion did not finish. */
+    if (converted && select_device(rom_address)) {
+      ONEWIRE_WRITE_BYTE(THERMOMETER_READ_SCRATCHPAD);
+
+      /* A valid scratchpad, CRC8 included, gives a zero CRC8. */
+
+      onewire_state.crc8 = 0;
+      for (index = 1; index <= THERMOMETER_SCRATCHPAD_SIZE; index++) {
+        result[index] = ONEWIRE_READ_BYTE();
+        update_crc8(result[index]);
+      }
+
+      if (onewire_state.crc8 == 0) {
+        *result = BP_BINARY_IO_RESULT_SUCCESS;
+      }
+    } else {
+      memset(&result[1], 0xFF, THERMOMETER_SCRATCHPAD_SIZE);
+    }
+
+    rom_address += ROM_BYTES_SIZE;
+    result += 1 + THERMOMETER_SCRATCHPAD_SIZE;
+  }
+
+  bp_write_buffer(bus_pirate_configuration.terminal_input +
+                      (sensors * ROM_BYTES_SIZE),
+                  sensors * (1 + THERMOMETER_SCRATCHPAD_SIZE));
+}
+
+bool select_device(const uint8_t *rom_address) {
+  size_t index;
+
+  if (perform_bus_reset() != ONEWIRE_BUS_RESET_OK) {
+    return false;
+  }
+
+  if (rom_address == NULL) {
+    ONEWIRE_WRITE_BYTE(MACRO_SKIP_ROM);
+    return true;
+  }
+
+  ONEWIRE_WRITE_BYTE(MACRO_MATCH_ROM);
+  for (index = 0; index < ROM_BYTES_SIZE; index++) {
+    ONEWIRE_WRITE_BYTE(rom_address[index]);
+  }
+
+  return true;
+}
+
+bool read_device_addressing(uint8_t *rom_address, const uint8_t **selection) {
+  size_t index;
+
+  switch (user_serial_read_byte()) {
+  case ADDRESSING_SKIP_ROM:
+    *selection = NULL;
+    return true;
+
+  case ADDRESSING_MATCH_ROM:
+    for (index = 0; index < ROM_BYTES_SIZE; index++) {
+      rom_address[index] = user_serial_read_byte();
+    }
+    *selection = rom_address;
+    return true;
+
+  default:
+    return false;
+  }
+}
+
+bool write_memory_page(const uint8_t *rom_address, const uint16_t address,
+                       const uint8_t *data, const uint8_t length) {
+  uint16_t crc;
+  uint8_t value;
+  uint8_t end_status;
+  size_t index;
+  bool result;
+
+  /* Write Scratchpad: command, address, data, then the device's CRC16. */
+
+  if (!select_device(rom_address)) {
+    return false;
+  }
+
+  ONEWIRE_WRITE_BYTE(MEMORY_WRITE_SCRATCHPAD);
+  crc = update_crc16(0, MEMORY_WRITE_SCRATCHPAD);
+  ONEWIRE_WRITE_BYTE(LO8(address));
+  crc = update_crc16(crc, LO8(address));
+  ONEWIRE_WRITE_BYTE(HI8(address));
+  crc = update_crc16(crc, HI8(address));
+  for (index = 0; index < length; index++) {
+    ONEWIRE_WRITE_BYTE(data[index]);
+    crc = update_crc16(crc, data[index]);
+  }
+  crc = update_crc16(crc, ONEWIRE_READ_BYTE());
+  crc = update_crc16(crc, ONEWIRE_READ_BYTE());
+  if (crc != CRC16_RESIDUE) {
+    return false;
+  }
+
+  /* Read Scratchpad: address, E/S, data, then the device's CRC16. */
+
+  if (!select_device(rom_address)) {
+    return false;
+  }
+
+  ONEWIRE_WRITE_BYTE(MEMORY_READ_SCRATCHPAD);
+  crc = update_crc16(0, MEMORY_READ_SCRATCHPAD);
+  value = ONEWIRE_READ_BYTE();
+  crc = update_crc16(crc, value);
+  result = (value == LO8(address));
+  value = ONEWIRE_READ_BYTE();
+  crc = update_crc16(crc, value);
+  result &= (value == HI8(address));
+  end_status = ONEWIRE_READ_BYTE();
+  crc = update_crc16(crc, end_status);
+  result &= ((end_status & MEMORY_ES_PARTIAL_FLAG) == 0);
+  for (index = 0; index < length; index++) {
+    value = ONEWIRE_READ_BYTE();
+    crc = update_crc16(crc, value);
+    result &= (value == data[index]);
+  }
+  crc = update_crc16(crc, ONEWIRE_READ_BYTE());
+  crc = update_crc16(crc, ONEWIRE_READ_BYTE());
+  if (!result || (crc != CRC16_RESIDUE)) {
+    return false;
+  }
+
+  /* Copy Scratchpad: the address and E/S bytes act as authorisation. */
+
+  if (!select_device(rom_address)) {
+    return false;
+  }
+
+  ONEWIRE_WRITE_BYTE(MEMORY_COPY_SCRATCHPAD);
+  ONEWIRE_WRITE_BYTE(LO8(address));
+  ONEWIRE_WRITE_BYTE(HI8(address));
+  ONEWIRE_WRITE_BYTE(end_status);
+  bp_delay_ms(MEMORY_PROGRAMMING_TIME);
+
+  return ONEWIRE_READ_BYTE() == MEMORY_COPY_DONE_PATTERN;
+}
+
 #ifdef BP_1WIRE_LOOKUP_FAMILY_ID
 
 void lookup_device_model(const uint8_t model) {
@@ -1186,6 +1804,11 @@ uint8_t update_crc8(const uint8_t value) {
   return onewire_state.crc8;
 }
 
+uint16_t update_crc16(uint16_t crc, const uint8_t value) {
+  crc = (crc >> 4) ^ CRC16_TABLE[(crc ^ value) & 0x0F];
+  return (crc >> 4) ^ CRC16_TABLE[(crc ^ (value >> 4)) & 0x0F];
+}
+
 void binary_io_enter_1wire_mode(void) {
   uint8_t input_byte;
   uint8_t command;
@@ -1202,6 +1825,10 @@ void binary_io_enter_1wire_mode(void) {
 
   mode_configuration.lsbEN = false;
 
+  /* Binary raw-wire mode may have left a different speed value behind. */
+
+  mode_configuration.speed = ONEWIRE_SPEED_STANDARD;
+
   /* Send version string. */
 
   MSG_1WIRE_MODE_IDENTIFIER;
@@ -1225,10 +1852,131 @@ void binary_io_enter_1wire_mode(void) {
         REPORT_IO_SUCCESS();
         break;
 
+      case BINARY_IO_ONEWIRE_ACTION_OVERDRIVE_SKIP_ROM:
+        user_serial_transmit_character(
+            (enter_overdrive_speed(MACRO_OVERDRIVE_SKIP_ROM) ==
+             ONEWIRE_BUS_RESET_OK)
+                ? BP_BINARY_IO_RESULT_SUCCESS
+                : BP_BINARY_IO_RESULT_FAILURE);
+        break;
+
       case BINARY_IO_ONEWIRE_ACTION_READ_BYTE:
         user_serial_transmit_character(ONEWIRE_READ_BYTE());
         break;
 
+      case BINARY_IO_ONEWIRE_ACTION_OVERDRIVE_MATCH_ROM: {
+        uint8_t rom_address[ROM_BYTES_SIZE];
+        size_t index;
+
+        /* Get the whole address first, the bus timing cannot wait on USB. */
+
+        for (index = 0; index < ROM_BYTES_SIZE; index++) {
+          rom_address[index] = user_serial_read_byte();
+        }
+
+        if (enter_overdrive_speed(MACRO_OVERDRIVE_MATCH_ROM) !=
+            ONEWIRE_BUS_RESET_OK) {
+          REPORT_IO_FAILURE();
+          break;
+        }
+
+        for (index = 0; index < ROM_BYTES_SIZE; index++) {
+          ONEWIRE_WRITE_BYTE(rom_address[index]);
+        }
+        REPORT_IO_SUCCESS();
+        break;
+      }
+
+      case BINARY_IO_ONEWIRE_ACTION_SENSOR_SWEEP: {
+        uint8_t sensors;
+        uint8_t wait_mode;
+        size_t index;
+
+        sensors = user_serial_read_byte();
+        if ((sensors == 0) || (sensors > SENSOR_SWEEP_MAXIMUM_SENSORS)) {
+          REPORT_IO_FAILURE();
+          break;
+        }
+        REPORT_IO_SUCCESS();
+
+        wait_mode = user_serial_read_byte();
+        for (index = 0; index < (sensors * ROM_BYTES_SIZE); index++) {
+          bus_pirate_configuration.terminal_input[index] =
+              user_serial_read_byte();
+        }
+
+        perform_sensor_sweep(sensors, wait_mode);
+        break;
+      }
+
+      case BINARY_IO_ONEWIRE_ACTION_MEMORY_READ: {
+        uint8_t rom_address[ROM_BYTES_SIZE];
+        const uint8_t *selection;
+        uint16_t address;
+        uint16_t length;
+        size_t index;
+
+        if (!read_device_addressing(rom_address, &selection)) {
+          REPORT_IO_FAILURE();
+          break;
+        }
+        address = user_serial_read_byte() << 8;
+        address |= user_serial_read_byte();
+        length = user_serial_read_byte() << 8;
+        length |= user_serial_read_byte();
+
+        if ((length == 0) || (length > BP_TERMINAL_BUFFER_SIZE) ||
+            !select_device(selection)) {
+          REPORT_IO_FAILURE();
+          break;
+        }
+
+        ONEWIRE_WRITE_BYTE(MEMORY_READ_MEMORY);
+        ONEWIRE_WRITE_BYTE(LO8(address));
+        ONEWIRE_WRITE_BYTE(HI8(address));
+        for (index = 0; index < length; index++) {
+          bus_pirate_configuration.terminal_input[index] = ONEWIRE_READ_BYTE();
+        }
+
+        REPORT_IO_SUCCESS();
+        bp_write_buffer(bus_pirate_configuration.terminal_input, length);
+        break;
+      }
+
+      case BINARY_IO_ONEWIRE_ACTION_MEMORY_WRITE_PAGE: {
+        uint8_t rom_address[ROM_BYTES_SIZE];
+        uint8_t data[MEMORY_MAXIMUM_SCRATCHPAD_SIZE];
+        const uint8_t *selection;
+        uint16_t address;
+        uint8_t length;
+        size_t index;
+
+        if (!read_device_addressing(rom_address, &selection)) {
+          REPORT_IO_FAILURE();
+          break;
+        }
+        address = user_serial_read_byte() << 8;
+        address |= user_serial_read_byte();
+        length = user_serial_read_byte();
+
+        if ((length == 0) || (length > MEMORY_MAXIMUM_SCRATCHPAD_SIZE)) {
+          REPORT_IO_FAILURE();
+          break;
+        }
+        REPORT_IO_SUCCESS();
+
+        for (index = 0; index < length; index++) {
+          data[index] = user_serial_read_byte();
+        }
+
+        if (write_memory_page(selection, address, data, length)) {
+          REPORT_IO_SUCCESS();
+        } else {
+          REPORT_IO_FAILURE();
+        }
+        break;
+      }
+
       case BINARY_IO_ONEWIRE_ACTION_ROM_SEARCH_MACRO:
       case BINARY_IO_ONEWIRE_ACTION_ALARM_SEARCH_MACRO: {
         bool next;
@@ -1309,7 +2057,7 @@ bool onewire_internal_bit_io(bool bit_value) {
   ONEWIRE_DATA_DIRECTION = OUTPUT;
 
   /* AN126: Parameter A */
-  if (mode_configuration.speed == 0) {
+  if (mode_configuration.speed == ONEWIRE_SPEED_STANDARD) {
     bp_delay_us(4);
   } else {
     bp_delay_us(1);
@@ -1318,8 +2066,10 @@ bool onewire_internal_bit_io(bool bit_value) {
     ONEWIRE_DATA_DIRECTION = INPUT;
   }
   /* AN126: Parameter E */
-  if (mode_configuration.speed == 0) {
+  if (mode_configuration.speed == ONEWIRE_SPEED_STANDARD) {
     bp_delay_us(8);
+  } else {
+    bp_delay_us(1);
   }
 
   /*
@@ -1334,21 +2084,21 @@ bool onewire_internal_bit_io(bool bit_value) {
   if (bit_value) {
     bit_value = ONEWIRE_DATA_LINE;
     /* AN126: Parameter F */
-    if (mode_configuration.speed == 0) {
+    if (mode_configuration.speed == ONEWIRE_SPEED_STANDARD) {
       bp_delay_us(32);
     } else {
-      bp_delay_us(6);
+      bp_delay_us(7);
     }
   } else {
     /* AN126: Parameter C */
-    if (mode_configuration.speed == 0) {
+    if (mode_configuration.speed == ONEWIRE_SPEED_STANDARD) {
       bp_delay_us(25);
     } else {
-      bp_delay_us(4);
+      bp_delay_us(7);
     }
     ONEWIRE_DATA_DIRECTION = INPUT;
     /* AN126: Parameter D */
-    if (mode_configuration.speed == 0) {
+    if (mode_configuration.speed == ONEWIRE_SPEED_STANDARD) {
       bp_delay_us(7);
     } else {
       bp_delay_us(2);
@@ -1357,7 +2107,7 @@ bool onewire_internal_bit_io(bool bit_value) {
 
   /* Adjust timing to take 70us per bit for standard mode. */
 
-  if (mode_configuration.speed == 0) {
+  if (mode_configuration.speed == ONEWIRE_SPEED_STANDARD) {
     bp_delay_us(5);
   }
 
@@ -1387,7 +2137,7 @@ uint8_t onewire_internal_byte_io(uint8_t byte_value) {
     }
   }
 
-  if (mode_configuration.speed == 0) {
+  if (mode_configuration.speed == ONEWIRE_SPEED_STANDARD) {
     bp_delay_us(8);
   }
 
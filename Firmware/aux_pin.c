@@ -613,6 +613,279 @@ uint32_t poll_frequency_counter_value(void) {
 #define IC2ICBNE IC2CONbits.ICBNE
 #endif /* BUSPIRATEV4 */
 
+#ifdef BP_ENABLE_FREQUENCY_STREAM
+
+#if defined(BUSPIRATEV4)
+#define IC1ICOV IC1CON1bits.ICOV
+#define IC2ICOV IC2CON1bits.ICOV
+#else
+#define IC1ICOV IC1CONbits.ICOV
+#define IC2ICOV IC2CONbits.ICOV
+#endif /* BUSPIRATEV4 */
+
+/**
+ * @brief Depth of the input capture FIFOs.
+ */
+#define INPUT_CAPTURE_FIFO_DEPTH 4
+
+/**
+ * @brief Background frequency measurement state.
+ */
+typedef struct {
+  /** Measurements for the gate in progress. */
+  bp_frequency_measurement_t gate;
+  /** Timebase value when the gate in progress started. */
+  uint32_t gate_start;
+  /** Last rising edge timestamp. */
+  uint32_t last_rise;
+  /** High time of the period in progress. */
+  uint32_t pending_high;
+  /** Upper 16 bits of the timebase, Timer3 being the lower 16 bits. */
+  uint16_t timebase_high;
+  /** Timer3 value at the last poll. */
+  uint16_t last_timebase;
+  /** Timer2 value at the last poll. */
+  uint16_t last_counter;
+  /** Whether last_rise holds a valid timestamp. */
+  bool rise_valid;
+} frequency_measurement_state_t;
+
+static frequency_measurement_state_t measurement_state;
+
+void bp_frequency_measurement_start(void) {
+  stop_timers();
+  T3CON = 0x0000;
+  memset(&measurement_state, 0, sizeof(measurement_state));
+
+  AUXPIN_DIR = INPUT;
+  RPINR3bits.T2CKR = AUXPIN_RPIN;
+  RPINR7bits.IC1R = AUXPIN_RPIN;
+  RPINR7bits.IC2R = AUXPIN_RPIN;
+
+  PR2 = 0xFFFF;
+  PR3 = 0xFFFF;
+  TMR2 = 0x0000;
+  TMR3 = 0x0000;
+
+  /*
+   * T2CON
+   *
+   * MSB
+   * 0-0------000-1-
+   * | |      ||| |
+   * | |      ||| +--- TCS:   External clock from pin.
+   * | |      ||+----- T32:   TIMER2 is not bound with TIMER3 for 32 bit mode.
+   * | |      ++------ TCKPS: 1:1 Prescaler.
+   * | +-------------- TSIDL: Continue module operation in idle mode.
+   * +---------------- TON:   Timer OFF.
+   */
+  T2CON = ON << _T2CON_TCS_POSITION;
+
+  /*
+   * T3CON
+   *
+   * MSB
+   * 0-0------01---0-
+   * | |      ||   |
+   * | |      ||   +--- TCS:   Internal clock.
+   * | |      ++------ TCKPS: 1:8 Prescaler, 2MHz.
+   * | +-------------- TSIDL: Continue module operation in idle mode.
+   * +---------------- TON:   Timer OFF.
+   */
+  T3CON = 0b01 << _T3CON_TCKPS_POSITION;
+
+#if defined(BUSPIRATEV4)
+
+  /*
+   * IC1CON1 and IC2CON1
+   *
+   * MSB
+   * --0000---00--011 (IC1), --0000---00--010 (IC2)
+   *   ||||   ||  |||
+   *   ||||   ||  +++-- ICM:    Capture every rising (IC1) or falling (IC2)
+   *   ||||   ||                edge.
+   *   ||||   ++------- ICI:    Interrupt on every capture event.
+   *   |+++------------ ICTSEL: Use input capture timer 3.
+   *   +--------------- ICSIDL: Input capture continues on CPU idle mode.
+   */
+  IC1CON1 = (0b011 << _IC1CON1_ICM_POSITION);
+  IC2CON1 = (0b010 << _IC2CON1_ICM_POSITION);
+
+  /*
+   * IC1CON2 and IC2CON2
+   *
+   * MSB
+   * -------000-01101
+   *        ||| |||||
+   *        ||| +++++-- SYNCSEL:  Synchronize with Timer3, so both capture
+   *        |||                   timers follow TMR3.
+   *        ||+-------- TRIGSTAT: Timer source has not been triggered.
+   *        |+--------- ICTRIG:   Synchronize input capture with SYNCSEL source.
+   *        +---------- IC32:     Do not cascade input capture units.
+   */
+  IC1CON2 = 0b01101 << _IC1CON2_SYNCSEL_POSITION;
+  IC2CON2 = 0b01101 << _IC2CON2_SYNCSEL_POSITION;
+
+#else
+
+  /*
+   * IC1CON and IC2CON
+   *
+   * MSB
+   * --0-----000--011 (IC1), --0-----000--010 (IC2)
+   *   |     |||  |||
+   *   |     |||  +++-- ICM:    Capture every rising (IC1) or falling (IC2)
+   *   |     |||                edge.
+   *   |     |++------- ICI:    Interrupt on every capture event.
+   *   |     +--------- ICTMR:  TMR3 contents are captured on event.
+   *   +--------------- ICSIDL: Input capture continues on CPU idle.
+   */
+  IC1CON = 0b011 << _IC2CON_ICM_POSITION;
+  IC2CON = 0b010 << _IC2CON_ICM_POSITION;
+
+#endif /* BUSPIRATEV4 */
+
+  T2CONbits.TON = ON;
+  T3CONbits.TON = ON;
+}
+
+/**
+ * @brief Reads the input capture FIFO of one unit.
+ *
+ * @param[out] captures the buffer to fill with the captured values.
+ * @param[in] unit 1 for the rising edges unit, 2 for the falling edges unit.
+ *
+ * @return the number of captured values read.
+ */
+static uint8_t read_input_captures(uint16_t *captures, const uint8_t unit) {
+  uint8_t count = 0;
+
+  if (unit == 1) {
+    if (IC1ICOV == ON) {
+      measurement_state.gate.overflow = true;
+      measurement_state.rise_valid = false;
+    }
+    while ((IC1ICBNE == ON) && (count < INPUT_CAPTURE_FIFO_DEPTH)) {
+      captures[count++] = IC1BUF;
+    }
+  } else {
+    if (IC2ICOV == ON) {
+      measurement_state.gate.overflow = true;
+      measurement_state.rise_valid = false;
+    }
+    while ((IC2ICBNE == ON) && (count < INPUT_CAPTURE_FIFO_DEPTH)) {
+      captures[count++] = IC2BUF;
+    }
+  }
+
+  return count;
+}
+
+/**
+ * @brief Turns a captured Timer3 value into a full timebase timestamp.
+ *
+ * The capture happened before Timer3 was last read, so a value above the one
+ * read belongs to the previous Timer3 period.
+ */
+static uint32_t extend_capture(const uint16_t capture) {
+  uint16_t high = measurement_state.timebase_high;
+
+  if (capture > measurement_state.last_timebase) {
+    high--;
+  }
+
+  return ((uint32_t)high << 16) | capture;
+}
+
+bool bp_frequency_measurement_poll(const uint32_t gate_ticks,
+                                   bp_frequency_measurement_t *measurement) {
+  uint16_t rises[INPUT_CAPTURE_FIFO_DEPTH];
+  uint16_t falls[INPUT_CAPTURE_FIFO_DEPTH];
+  uint8_t rise_count;
+  uint8_t fall_count;
+  uint8_t rise_index;
+  uint8_t fall_index;
+  uint16_t timebase;
+  uint16_t counter;
+  uint32_t rise;
+  uint32_t fall;
+  uint32_t now;
+
+  rise_count = read_input_captures(rises, 1);
+  fall_count = read_input_captures(falls, 2);
+
+  timebase = TMR3;
+  if (timebase < measurement_state.last_timebase) {
+    measurement_state.timebase_high++;
+  }
+  measurement_state.last_timebase = timebase;
+  now = ((uint32_t)measurement_state.timebase_high << 16) | timebase;
+
+  counter = TMR2;
+  measurement_state.gate.edges +=
+      (uint16_t)(counter - measurement_state.last_counter);
+  measurement_state.last_counter = counter;
+
+  /* Go through the edges in the order they happened. */
+  rise_index = 0;
+  fall_index = 0;
+  while ((rise_index < rise_count) || (fall_index < fall_count)) {
+    rise = (rise_index < rise_count) ? extend_capture(rises[rise_index]) : 0;
+    fall = (fall_index < fall_count) ? extend_capture(falls[fall_index]) : 0;
+
+    if ((fall_index == fall_count) ||
+        ((rise_index < rise_count) && ((int32_t)(rise - fall) < 0))) {
+      if (measurement_state.rise_valid) {
+        measurement_state.gate.periods++;
+        measurement_state.gate.period_ticks +=
+            rise - measurement_state.last_rise;
+        measurement_state.gate.high_ticks += measurement_state.pending_high;
+      }
+      measurement_state.pending_high = 0;
+      measurement_state.last_rise = rise;
+      measurement_state.rise_valid = true;
+      rise_index++;
+    } else {
+      if (measurement_state.rise_valid) {
+        measurement_state.pending_high = fall - measurement_state.last_rise;
+      }
+      fall_index++;
+    }
+  }
+
+  if ((now - measurement_state.gate_start) < gate_ticks) {
+    return false;
+  }
+
+  *measurement = measurement_state.gate;
+  memset(&measurement_state.gate, 0, sizeof(measurement_state.gate));
+  measurement_state.gate_start += gate_ticks;
+
+  return true;
+}
+
+void bp_frequency_measurement_stop(void) {
+  stop_timers();
+  T3CON = 0x0000;
+
+#if defined(BUSPIRATEV4)
+  IC1CON1 = 0x0000;
+  IC2CON1 = 0x0000;
+  IC1CON2 = 0x0000;
+  IC2CON2 = 0x0000;
+#else
+  IC1CON = 0x0000;
+  IC2CON = 0x0000;
+#endif /* BUSPIRATEV4 */
+
+  /* Detach Timer2 Clock signal and input captures from the AUX pin. */
+  RPINR3bits.T2CKR = 0b11111;
+  RPINR7bits.IC1R = 0b11111;
+  RPINR7bits.IC2R = 0b11111;
+}
+
+#endif /* BP_ENABLE_FREQUENCY_STREAM */
+
 uint32_t average_sample_frequency(const uint16_t count) {
   uint32_t current_low, counter_low, current_high, counter_high, total_samples;
   uint16_t index;
@@ -1176,3 +1449,278 @@ void stop_timers(void) {
    */
   T2CON = 0x0000;
 }
+
+#ifdef BP_ENABLE_SOFTWARE_PWM
+
+/**
+ * @brief One software PWM edge.
+ */
+typedef struct {
+  /** Channel latch bits lowered at this edge. */
+  uint16_t clear;
+  /** Timer1 period leading to the next edge. */
+  uint16_t ticks;
+} software_pwm_edge_t;
+
+/**
+ * @brief A software PWM period worth of edges, sorted by time.
+ *
+ * The first edge starts the period, it also raises the channels that are not
+ * fully off and lowers those that are.
+ */
+typedef struct {
+  /** Edges, the first one starting the period. */
+  software_pwm_edge_t edges[SOFTWARE_PWM_CHANNELS + 1];
+  /** Channel latch bits raised at the start of the period. */
+  uint16_t set;
+  /** Number of edges in use. */
+  uint8_t count;
+} software_pwm_schedule_t;
+
+/**
+ * @brief Software PWM scheduler state.
+ */
+typedef struct {
+  /** Schedule being played, and the one being prepared for an update. */
+  software_pwm_schedule_t schedules[2];
+  /** Period length, in Timer1 ticks. */
+  uint16_t period;
+  /** Shortest time between two edges, in Timer1 ticks. */
+  uint16_t minimum_ticks;
+  /** Index of the schedule being played. */
+  volatile uint8_t active;
+  /** The other schedule is to be played from the next period on. */
+  volatile bool pending;
+  /** Next edge of the schedule being played. */
+  uint8_t edge;
+  /** Whether the scheduler is running. */
+  bool running;
+} software_pwm_state_t;
+
+static software_pwm_state_t software_pwm_state;
+
+/**
+ * @brief Latch bits of the software PWM channels, in channel order.
+ */
+static const uint16_t software_pwm_pins[SOFTWARE_PWM_CHANNELS] = {
+    AUX, MOSI, CLK, MISO, CS};
+
+/**
+ * @brief Turns the given duty cycles into a sorted list of edges.
+ *
+ * @param[out] schedule the schedule to fill.
+ * @param[in] duty_cycles the channels high time, in Timer1 ticks.
+ *
+ * @return false if a duty cycle is longer than the period, true otherwise.
+ */
+static bool software_pwm_build_schedule(software_pwm_schedule_t *schedule,
+                                        const uint16_t *duty_cycles) {
+  uint16_t offsets[SOFTWARE_PWM_CHANNELS + 1];
+  uint16_t duty_cycle;
+  uint8_t channel;
+  uint8_t edge;
+  uint8_t index;
+
+  for (channel = 0; channel < SOFTWARE_PWM_CHANNELS; channel++) {
+    if (duty_cycles[channel] > software_pwm_state.period) {
+      return false;
+    }
+  }
+
+  schedule->set = 0;
+  schedule->count = 1;
+  schedule->edges[0].clear = 0;
+  offsets[0] = 0;
+
+  for (channel = 0; channel < SOFTWARE_PWM_CHANNELS; channel++) {
+    duty_cycle = duty_cycles[channel];
+
+    /* Too close to the end of the period, the channel stays high. */
+    if ((software_pwm_state.period - duty_cycle) <
+        software_pwm_state.minimum_ticks) {
+      schedule->set |= software_pwm_pins[channel];
+      continue;
+    }
+
+    /* Insertion sort, the list holds at most one edge per channel. */
+    for (edge = 0; (edge < schedule->count) && (offsets[edge] < duty_cycle);
+         edge++) {
+    }
+
+    /* Edges closer than the minimum to the previous one are merged in it. */
+    if ((edge < schedule->count) && (offsets[edge] == duty_cycle)) {
+      schedule->edges[edge].clear |= software_pwm_pins[channel];
+    } else if ((duty_cycle - offsets[edge - 1]) <
+               software_pwm_state.minimum_ticks) {
+      schedule->edges[edge - 1].clear |= software_pwm_pins[channel];
+    } else {
+      for (index = schedule->count; index > edge; index--) {
+        offsets[index] = offsets[index - 1];
+        schedule->edges[index].clear = schedule->edges[index - 1].clear;
+      }
+      offsets[edge] = duty_cycle;
+      schedule->edges[edge].clear = software_pwm_pins[channel];
+      schedule->count++;
+    }
+    schedule->set |= software_pwm_pins[channel];
+  }
+
+  /*
+   * Merging into the previous edge may have left an edge too close to the
+   * next one, fold those pairs together.
+   */
+  for (edge = 1; edge < schedule->count;) {
+    if ((offsets[edge] - offsets[edge - 1]) < software_pwm_state.minimum_ticks) {
+      schedule->edges[edge - 1].clear |= schedule->edges[edge].clear;
+      for (index = edge; index < (schedule->count - 1); index++) {
+        offsets[index] = offsets[index + 1];
+        schedule->edges[index].clear = schedule->edges[index + 1].clear;
+      }
+      schedule->count--;
+    } else {
+      edge++;
+    }
+  }
+  schedule->set &= ~schedule->edges[0].clear;
+
+  for (edge = 0; edge < schedule->count; edge++) {
+    schedule->edges[edge].ticks =
+        ((edge + 1 < schedule->count) ? offsets[edge + 1]
+                                      : software_pwm_state.period) -
+        offsets[edge] - 1;
+  }
+
+  return true;
+}
+
+bool bp_software_pwm_start(const uint8_t prescaler, const uint16_t period,
+                           const uint16_t *duty_cycles) {
+  static const uint16_t prescalers[] = {1, 8, 64, 256};
+  uint8_t channel;
+
+  bp_software_pwm_stop();
+
+  if (((uint32_t)period * prescalers[prescaler & 0b11]) <
+      SOFTWARE_PWM_MINIMUM_CYCLES) {
+    return false;
+  }
+
+  software_pwm_state.period = period;
+  software_pwm_state.minimum_ticks =
+      (SOFTWARE_PWM_MINIMUM_CYCLES + prescalers[prescaler & 0b11] - 1) /
+      prescalers[prescaler & 0b11];
+  if (!software_pwm_build_schedule(&software_pwm_state.schedules[0],
+                                   duty_cycles)) {
+    return false;
+  }
+  software_pwm_state.active = 0;
+  software_pwm_state.pending = false;
+  software_pwm_state.edge = 0;
+
+  /* The hardware PWM cannot keep driving AUX. */
+  if (state.mode == AUX_MODE_PWM) {
+    OC5CON = 0x0000;
+    AUXPIN_RPOUT = 0;
+    state.mode = AUX_MODE_IO;
+  }
+  for (channel = 0; channel < SOFTWARE_PWM_CHANNELS; channel++) {
+    IOLAT &= ~software_pwm_pins[channel];
+  }
+
+  /*
+   * T1CON
+   *
+   * MSB
+   * 0-0------0xx-0-
+   * | |      ||| |
+   * | |      ||| +--- TCS:   Internal clock.
+   * | |      |++----- TCKPS: As requested.
+   * | |      +------- TGATE: Gated time accumulation disabled.
+   * | +-------------- TSIDL: Continue module operation in idle mode.
+   * +---------------- TON:   Timer OFF.
+   */
+  T1CON = (prescaler & 0b11) << _T1CON_TCKPS_POSITION;
+  TMR1 = 0;
+
+  /* The first period starts right away. */
+  PR1 = software_pwm_state.minimum_ticks;
+
+  /* Served first when pending together with the communication interrupts. */
+  IPC0bits.T1IP = 5;
+  IFS0bits.T1IF = OFF;
+  IEC0bits.T1IE = ON;
+  software_pwm_state.running = true;
+  T1CONbits.TON = ON;
+
+  return true;
+}
+
+bool bp_software_pwm_update(const uint16_t *duty_cycles) {
+  if (!software_pwm_state.running) {
+    return false;
+  }
+
+  /* The spare schedule may be about to be picked up. */
+  while (software_pwm_state.pending) {
+  }
+
+  if (!software_pwm_build_schedule(
+          &software_pwm_state.schedules[software_pwm_state.active ^ 1],
+          duty_cycles)) {
+    return false;
+  }
+  software_pwm_state.pending = true;
+
+  return true;
+}
+
+void bp_software_pwm_stop(void) {
+  uint8_t channel;
+
+  if (!software_pwm_state.running) {
+    return;
+  }
+
+  IEC0bits.T1IE = OFF;
+  T1CON = 0x0000;
+  IFS0bits.T1IF = OFF;
+  software_pwm_state.running = false;
+  for (channel = 0; channel < SOFTWARE_PWM_CHANNELS; channel++) {
+    IOLAT &= ~software_pwm_pins[channel];
+  }
+}
+
+void __attribute__((interrupt, no_auto_psv)) _T1Interrupt(void) {
+  const software_pwm_schedule_t *schedule;
+  uint8_t edge;
+
+  edge = software_pwm_state.edge;
+  if ((edge == 0) && software_pwm_state.pending) {
+    software_pwm_state.active ^= 1;
+    software_pwm_state.pending = false;
+  }
+  schedule = &software_pwm_state.schedules[software_pwm_state.active];
+
+  /*
+   * Timer1 is already counting towards the next edge.  If another interrupt
+   * delayed this one past it, have the edge happen late rather than after a
+   * full timer wrap.
+   */
+  PR1 = schedule->edges[edge].ticks;
+  if (TMR1 > PR1) {
+    TMR1 = PR1;
+  }
+  IOLAT &= ~schedule->edges[edge].clear;
+  if (edge == 0) {
+    IOLAT |= schedule->set;
+  }
+
+  if (++edge == schedule->count) {
+    edge = 0;
+  }
+  software_pwm_state.edge = edge;
+
+  IFS0bits.T1IF = OFF;
+}
+
+#endif /* BP_ENABLE_SOFTWARE_PWM */
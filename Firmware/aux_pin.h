@@ -27,6 +27,8 @@
 #include <stdbool.h>
 #include <stdint.h>
 
+#include "configuration.h"
+
 /**
  * @brief Minimum allowed frequency for the PWM generator, in Hz.
  *
@@ -122,9 +124,128 @@ void bp_frequency_counter_setup(void);
  */
 unsigned long bp_measure_frequency(void);
 
+#ifdef BP_ENABLE_FREQUENCY_STREAM
+
+/**
+ * @brief Input capture timebase frequency for frequency measurements, in Hz.
+ */
+#define FREQUENCY_MEASUREMENT_TICKS_PER_SECOND 2000000UL
+
+/**
+ * @brief One gate worth of AUX pin measurements.
+ *
+ * The gated count gives the frequency of fast signals, and the periods timed
+ * by input capture give the frequency and duty cycle of slower signals with a
+ * much better resolution:
+ *
+ * - frequency = edges / gate time;
+ * - frequency = periods * FREQUENCY_MEASUREMENT_TICKS_PER_SECOND /
+ *               period_ticks;
+ * - duty cycle = high_ticks / period_ticks.
+ */
+typedef struct {
+  /** Rising edges counted during the gate. */
+  uint32_t edges;
+  /** Whole signal periods timed by input capture during the gate. */
+  uint32_t periods;
+  /** Length of the timed periods, in timebase ticks. */
+  uint32_t period_ticks;
+  /** Time the signal was high during the timed periods, in timebase ticks. */
+  uint32_t high_ticks;
+  /** Input capture missed edges, the timed periods are not reliable. */
+  bool overflow;
+} bp_frequency_measurement_t;
+
+/**
+ * @brief Starts measuring the signal on the AUX pin in the background.
+ *
+ * Timer2 counts the AUX pin rising edges, while input capture units 1 and 2
+ * timestamp its rising and falling edges against Timer3.  Measurements are
+ * collected by calling bp_frequency_measurement_poll often enough, at least
+ * every few milliseconds.
+ */
+void bp_frequency_measurement_start(void);
+
+/**
+ * @brief Collects the measurements taken since the last call.
+ *
+ * @param[in] gate_ticks the gate time, in timebase ticks.
+ * @param[out] measurement filled with the gate results once a gate is over.
+ *
+ * @return true if a gate is over and measurement was filled, false otherwise.
+ */
+bool bp_frequency_measurement_poll(const uint32_t gate_ticks,
+                                   bp_frequency_measurement_t *measurement);
+
+/**
+ * @brief Stops the background measurements and frees the AUX pin.
+ */
+void bp_frequency_measurement_stop(void);
+
+#endif /* BP_ENABLE_FREQUENCY_STREAM */
+
 /**
  * @brief Starts the setup process for generating a PWM signal.
  */
 void bp_pwm_setup(void);
 
+#ifdef BP_ENABLE_SOFTWARE_PWM
+
+/**
+ * @brief Number of pins driven by the software PWM scheduler.
+ *
+ * Channels are, in order, AUX, MOSI, CLK, MISO and CS.
+ */
+#define SOFTWARE_PWM_CHANNELS 5
+
+/**
+ * @brief Shortest time between two software PWM edges, in instruction cycles.
+ *
+ * Falling edges closer than this to the previous edge are moved back onto it,
+ * and those closer to the end of the period are dropped, so the interrupt
+ * handler always has the time to run between two edges.
+ */
+#define SOFTWARE_PWM_MINIMUM_CYCLES 128
+
+/**
+ * @brief Starts driving the software PWM channels.
+ *
+ * Timer1 interrupts walk a list of edges sorted by time, so the cost of a
+ * period only depends on the number of distinct duty cycles.  The scheduler
+ * owns the channel pins latches while running: every channel is raised at the
+ * start of the period and lowered once its duty cycle is over, a duty cycle of
+ * zero keeping the pin low and one equal to the period keeping it high.
+ *
+ * @param[in] prescaler Timer1 prescaler selection, 0 to 3 for 1:1, 1:8, 1:64
+ *                      and 1:256.
+ * @param[in] period the period length, in prescaled ticks.
+ * @param[in] duty_cycles the channels high time, in prescaled ticks.
+ *
+ * @return false if the period is shorter than SOFTWARE_PWM_MINIMUM_CYCLES or
+ * a duty cycle is longer than the period, true otherwise.
+ */
+bool bp_software_pwm_start(const uint8_t prescaler, const uint16_t period,
+                           const uint16_t *duty_cycles);
+
+/**
+ * @brief Changes the software PWM duty cycles of all channels at once.
+ *
+ * The new duty cycles take effect together at the start of the next period,
+ * without restarting the period in progress.  Waits for an earlier update to
+ * be applied first, at most one period.
+ *
+ * @param[in] duty_cycles the channels high time, in prescaled ticks.
+ *
+ * @return false if the scheduler is not running or a duty cycle is longer
+ * than the period, true otherwise.
+ */
+bool bp_software_pwm_update(const uint16_t *duty_cycles);
+
+/**
+ * @brief Stops the software PWM scheduler, leaving all channel pins low.
+ */
+void bp_software_pwm_stop(void);
+
+#endif /* BP_ENABLE_SOFTWARE_PWM */
+
 #endif /* !BP_AUX_PIN_H */
@@ -107,6 +107,19 @@ static const uint8_t REVERSED_BITS_TABLE[] = {
     0x3F, 0xBF, 0x7F, 0xFF,
 };
 
+#else
+
+/**
+ * @brief Precomputed table with the reversed bit representation of all possible
+ * 4-bits integers.
+ *
+ * On v3 boards flash space is tight, so bytes are reversed one nibble at a time
+ * instead.
+ */
+static const uint8_t REVERSED_NIBBLES_TABLE[] = {
+    0x00, 0x08, 0x04, 0x0C, 0x02, 0x0A, 0x06, 0x0E,
+    0x01, 0x09, 0x05, 0x0D, 0x03, 0x0B, 0x07, 0x0F};
+
 #endif /* BUSPIRATEV4 */
 
 /**
@@ -221,6 +234,65 @@ uint16_t bp_read_adc(const uint16_t channel) {
   return ADC1BUF0;
 }
 
+/**
+ * Channels converted by bp_read_adc_channels, as an AD1CSSL mask.
+ */
+#define BP_ADC_SCAN_CHANNELS                                                   \
+  ((1 << BP_ADC_PROBE) | (1 << BP_ADC_VPU) | (1 << BP_ADC_3V3) |               \
+   (1 << BP_ADC_5V0))
+
+/**
+ * Number of channels converted by bp_read_adc_channels.
+ */
+#define BP_ADC_SCAN_COUNT 4
+
+/**
+ * Buffer slot of a scanned channel: channels are scanned in ascending order.
+ */
+#define BP_ADC_SCAN_SLOT(channel)                                              \
+  ((BP_ADC_PROBE < (channel)) + (BP_ADC_VPU < (channel)) +                     \
+   (BP_ADC_3V3 < (channel)) + (BP_ADC_5V0 < (channel)))
+
+void bp_read_adc_channels(bp_adc_channels_t *readings) {
+  volatile uint16_t *results = &ADC1BUF0;
+
+  /*
+   * AD1CON2 : A/D CONTROL REGISTER 2
+   *
+   * MSB
+   * 000--1--x-001100
+   * |||  |    ||||||
+   * |||  |    |||||+-- ALTS:  Use MUX A input settings.
+   * |||  |    ||||+--- BUFM:  Buffer is one single 16-bits word.
+   * |||  |    ++++---- SMPI:  Interrupt after the fourth conversion.
+   * |||  +------------ CSCNA: Scan the inputs selected in AD1CSSL.
+   * +++--------------- VCFG:  VR+ is AVdd and VR- is AVss.
+   */
+  AD1CSSL = BP_ADC_SCAN_CHANNELS;
+  AD1CON2 = 0x0400 | ((BP_ADC_SCAN_COUNT - 1) << 2);
+
+  /* Sample and convert each channel in turn. */
+  IFS0bits.AD1IF = OFF;
+  AD1CON1bits.ASAM = ON;
+  while (IFS0bits.AD1IF == OFF) {
+  }
+  AD1CON1bits.ASAM = OFF;
+
+  readings->probe = results[BP_ADC_SCAN_SLOT(BP_ADC_PROBE)];
+  readings->pullup = results[BP_ADC_SCAN_SLOT(BP_ADC_VPU)];
+  readings->supply_3v3 = results[BP_ADC_SCAN_SLOT(BP_ADC_3V3)];
+  readings->supply_5v0 = results[BP_ADC_SCAN_SLOT(BP_ADC_5V0)];
+
+  /* Let the sample started after the fourth conversion go through. */
+  AD1CON1bits.DONE = OFF;
+  while (AD1CON1bits.DONE == OFF) {
+  }
+  IFS0bits.AD1IF = OFF;
+
+  AD1CON2 = 0x0000;
+  AD1CSSL = 0x0000;
+}
+
 void bp_adc_probe(void) {
   /* Turn the ADC on. */
   AD1CON1bits.ADON = ON;
@@ -310,40 +382,17 @@ inline uint8_t bp_reverse_byte(const uint8_t value) {
 #ifdef BUSPIRATEV4
   return REVERSED_BITS_TABLE[value];
 #else
-  return bp_reverse_integer(value, 8);
+  return (REVERSED_NIBBLES_TABLE[value & 0x0F] << 4) |
+         REVERSED_NIBBLES_TABLE[value >> 4];
 #endif /* BUSPIRATEV4 */
 }
 
 inline uint16_t bp_reverse_word(const uint16_t value) {
-#ifdef BUSPIRATEV4
-  return (REVERSED_BITS_TABLE[value & 0xFF] << 8) |
-         REVERSED_BITS_TABLE[value >> 8];
-#else
-  return bp_reverse_integer(value, 16);
-#endif /* BUSPIRATEV4 */
+  return (bp_reverse_byte(value & 0xFF) << 8) | bp_reverse_byte(value >> 8);
 }
 
 uint16_t bp_reverse_integer(const uint16_t value, const uint8_t bits) {
-#ifdef BUSPIRATEV4
-  return ((REVERSED_BITS_TABLE[value & 0xFF] << 8) |
-          REVERSED_BITS_TABLE[value >> 8]) >>
-         ((sizeof(uint16_t) * 8) - bits);
-#else
-  uint16_t reversed;
-  uint16_t bitmask;
-
-  reversed = 0;
-  bitmask = 1;
-  while (bitmask != 0) {
-    reversed <<= 1;
-    if (value & bitmask) {
-      reversed |= 0b00000001;
-    }
-    bitmask <<= 1;
-  }
-
-  return reversed >> ((sizeof(uint16_t) * 8) - bits);
-#endif /* BUSPIRATEV4 */
+  return bp_reverse_word(value) >> ((sizeof(uint16_t) * 8) - bits);
 }
 
 void bp_write_buffer(const uint8_t *buffer, const size_t length) {
@@ -526,6 +575,24 @@ uint16_t bp_read_from_flash(const uint16_t page, const uint16_t address) {
 static uint16_t user_serial_ringbuffer_write;
 static uint16_t user_serial_ringbuffer_read;
 
+/**
+ * @brief Terminal output queue, drained by the UART1 transmission interrupt.
+ */
+typedef struct {
+  /** Characters waiting to be sent. */
+  uint8_t buffer[BP_USER_SERIAL_OUTPUT_BUFFER_SIZE];
+  /** Next character to send, only moved by the interrupt handler. */
+  volatile uint8_t read;
+  /** Next free slot, only moved by user_serial_transmit_character. */
+  volatile uint8_t write;
+  /** Whether output goes through the queue. */
+  bool enabled;
+} user_serial_output_queue_t;
+
+static user_serial_output_queue_t user_serial_output_queue;
+
+#define USER_SERIAL_OUTPUT_QUEUE_MASK (BP_USER_SERIAL_OUTPUT_BUFFER_SIZE - 1)
+
 #ifndef BP_ENABLE_UART_SUPPORT
 static const uint16_t UART_BRG_SPEED[] = {
     13332, /* 300 bps */
@@ -592,6 +659,9 @@ bool user_serial_transmit_done(void) { return U1STAbits.TRMT; }
 bool user_serial_ready_to_read(void) { return U1STAbits.URXDA; }
 
 void user_serial_ringbuffer_setup(void) {
+  /* The ringbuffer writes to UART1 directly. */
+  user_serial_set_output_buffering(NO);
+
   user_serial_ringbuffer_read = 0;
   user_serial_ringbuffer_write = 1;
   bus_pirate_configuration.overflow = NO;
@@ -670,11 +740,29 @@ uint8_t user_serial_read_byte(void) {
 }
 
 void user_serial_transmit_character(const char character) {
+  uint8_t next;
+
   /* Do not transmit if the board should be quiet. */
   if (bus_pirate_configuration.quiet) {
     return;
   }
 
+  if (user_serial_output_queue.enabled) {
+    next = (user_serial_output_queue.write + 1) & USER_SERIAL_OUTPUT_QUEUE_MASK;
+
+    /* Wait until the interrupt handler makes some room. */
+    while (next == user_serial_output_queue.read) {
+    }
+
+    user_serial_output_queue.buffer[user_serial_output_queue.write] = character;
+    user_serial_output_queue.write = next;
+
+    /* Have the interrupt handler pick it up even if UART1 is idle. */
+    IEC0bits.U1TXIE = ON;
+    IFS0bits.U1TXIF = ON;
+    return;
+  }
+
   /* Wait until transmission can take place. */
   while (U1STAbits.UTXBF == ON) {
   }
@@ -682,7 +770,25 @@ void user_serial_transmit_character(const char character) {
   U1TXREG = character;
 }
 
+void user_serial_set_output_buffering(const bool enabled) {
+  if (enabled == user_serial_output_queue.enabled) {
+    return;
+  }
+
+  if (!enabled) {
+    /* Let the queue drain before writing to UART1 directly again. */
+    while (user_serial_output_queue.read != user_serial_output_queue.write) {
+    }
+    IEC0bits.U1TXIE = OFF;
+  }
+
+  user_serial_output_queue.enabled = enabled;
+}
+
 void user_serial_wait_transmission_done(void) {
+  while (user_serial_output_queue.read != user_serial_output_queue.write) {
+  }
+
   while (U1STAbits.TRMT == NO) {
   }
 }
@@ -733,6 +839,23 @@ void __attribute__((interrupt, no_auto_psv)) _U1RXInterrupt(void) {
 }
 
 void __attribute__((interrupt, no_auto_psv)) _U1TXInterrupt(void) {
+  if (user_serial_output_queue.enabled) {
+    IFS0bits.U1TXIF = OFF;
+
+    /* Fill the transmission FIFO from the output queue. */
+    while ((user_serial_output_queue.read != user_serial_output_queue.write) &&
+           (U1STAbits.UTXBF == OFF)) {
+      U1TXREG = user_serial_output_queue.buffer[user_serial_output_queue.read];
+      user_serial_output_queue.read =
+          (user_serial_output_queue.read + 1) & USER_SERIAL_OUTPUT_QUEUE_MASK;
+    }
+
+    if (user_serial_output_queue.read == user_serial_output_queue.write) {
+      IEC0bits.U1TXIE = OFF;
+    }
+    return;
+  }
+
   UART1TXSent++;
   if (UART1TXSent == UART1TXAvailable) {
     IEC0bits.U1TXIE = NO;
@@ -775,6 +898,8 @@ void user_serial_initialise(void) {}
 
 void user_serial_wait_transmission_done(void) { WaitInReady(); }
 
+void user_serial_set_output_buffering(const bool enabled) {}
+
 bool user_serial_check_overflow(void) { return NO; }
 
 void user_serial_clear_overflow(void) {}
@@ -223,6 +223,45 @@ void bp_reset_board_state(void);
  */
 uint16_t bp_read_adc(const uint16_t channel);
 
+/**
+ * @brief Readings of the voltage channels, taken in a single ADC scan.
+ */
+typedef struct {
+  /**
+   * The voltage probe (ADC pin).
+   */
+  uint16_t probe;
+
+  /**
+   * The external pull-up voltage (Vpu pin).
+   */
+  uint16_t pullup;
+
+  /**
+   * The 3.3v supply rail.
+   */
+  uint16_t supply_3v3;
+
+  /**
+   * The 5v supply rail.
+   */
+  uint16_t supply_5v0;
+} bp_adc_channels_t;
+
+/**
+ * @brief Reads the probe, pull-up, 3.3v and 5v channels in one ADC scan
+ * sequence.
+ *
+ * The four channels are converted back to back by the ADC scan logic into
+ * ADC1BUF0-3, instead of one conversion request per channel.
+ *
+ * @warning this function assumes the ADC is already enabled, and will not turn
+ *          it on or off.
+ *
+ * @param[out] readings the structure to fill with the channel readings.
+ */
+void bp_read_adc_channels(bp_adc_channels_t *readings);
+
 /**
  * @brief Takes one single ADC measurement and prints it to the serial port.
  */
@@ -468,6 +507,20 @@ void user_serial_process_transmission_interrupt(void);
  */
 void user_serial_transmit_character(const char character);
 
+/**
+ * @brief Queues terminal output instead of waiting for it to be sent.
+ *
+ * While enabled, characters written with user_serial_transmit_character go
+ * into a queue drained by the transmission interrupt, so bus operations carry
+ * on while earlier results are being sent.  Code writing to the serial port
+ * registers directly must disable queueing first.  On v4 the USB CDC layer
+ * already sends full packets in the background, so this does nothing there.
+ *
+ * @param[in] enabled YES to queue output, NO to wait for the queue to be sent
+ * and go back to direct transmission.
+ */
+void user_serial_set_output_buffering(const bool enabled);
+
 /**
  * @}
  */
@@ -49,6 +49,9 @@
 #ifdef BP_ENABLE_SMPS_SUPPORT
 #include "smps.h"
 #endif /* BP_ENABLE_SMPS_SUPPORT */
+#ifdef BP_ENABLE_SWD_SUPPORT
+#include "swd.h"
+#endif /* BP_ENABLE_SWD_SUPPORT */
 
 #include "aux_pin.h"
 #include "binary_io.h"
@@ -66,6 +69,166 @@ extern bus_pirate_configuration_t bus_pirate_configuration;
  */
 static void send_binary_io_mode_identifier(void);
 
+#ifdef BP_ENABLE_ADC_STREAMS
+
+/**
+ * Streams ADC readings from the voltage probe at a fixed rate, until any byte
+ * is received.
+ *
+ * Conversions are triggered by Timer3 and collected eight at a time in one
+ * half of the ADC result buffer while the other half is being sent, so the
+ * sample spacing only depends on the timer.
+ *
+ * PC -> Bus Pirate: 0x17, the Timer3 prescaler (bits 0-1: 1, 8, 64, 256), and
+ * the Timer3 period (MSB first), one sample being taken every
+ * (period + 1) * prescaler instruction cycles (16MHz).
+ *
+ * The Bus Pirate answers 0x00 if the period is shorter than a conversion, or
+ * 0x01 followed by 11 bytes blocks: a sequence number, then eight samples
+ * packed in two groups of 5 bytes.  Each group holds the upper 8 bits of four
+ * samples, followed by a byte holding their lower 2 bits, first sample in the
+ * top bits.  The sequence number goes up by one for each block acquired, so a
+ * gap means data was dropped because the serial link could not keep up.
+ */
+static void binary_io_adc_stream(void);
+
+/**
+ * Captures triggered oscilloscope frames from the voltage probe, uploading
+ * only complete frames, until any byte is received.
+ *
+ * The ADC runs at a fixed rate set by Timer3 as for the ADC stream, and the
+ * samples go into a ring in the terminal buffer.  Once enough samples are in
+ * the ring to fill the pretrigger part of the frame and the holdoff is over,
+ * every sample is checked against the trigger; the rest of the frame is then
+ * captured, the ADC is stopped and the frame is sent.
+ *
+ * PC -> Bus Pirate: 0x19, the Timer3 prescaler and period (as for 0x17), the
+ * frame length in samples (MSB first, a multiple of 4 up to 2048), the
+ * pretrigger percentage (0-100), the trigger level (MSB first, 0-1023), the
+ * slope (0 free running, 1 rising, 2 falling), and the holdoff in samples
+ * (MSB first), the minimum number of samples taken before the trigger is
+ * armed for each frame.
+ *
+ * The Bus Pirate answers 0x00 if the setup is invalid, or 0x01 followed by
+ * frames, each being 0x01 and then the samples packed 4 per 5 bytes as for
+ * the ADC stream.  Once the byte from the PC is received the current frame is
+ * completed or dropped if the trigger did not happen yet, and the Bus Pirate
+ * sends 0x00.
+ */
+static void binary_io_adc_scope(void);
+
+/**
+ * Streams timestamped readings of the probe, pull-up, 3.3v and 5v channels
+ * at a fixed rate, until any byte is received.
+ *
+ * Timer2 and Timer3 run as a free running 32 bits timer, and a scan of the
+ * four channels is started every time the given interval has elapsed.
+ *
+ * PC -> Bus Pirate: 0x1A, the timer prescaler (bits 0-1: 1, 8, 64, 256), and
+ * the interval between scans in timer ticks (MSB first).
+ *
+ * The Bus Pirate answers 0x00 if the interval is shorter than a scan, or 0x01
+ * followed by 9 bytes frames: the timer value when the scan started (MSB
+ * first), then the probe, pull-up, 3.3v and 5v readings packed as for the ADC
+ * stream.  Frames that could not be sent in time are skipped, which shows as
+ * a longer step between timestamps.
+ */
+static void binary_io_adc_telemetry(void);
+
+#endif /* BP_ENABLE_ADC_STREAMS */
+
+#ifdef BP_ENABLE_FREQUENCY_STREAM
+
+/**
+ * Streams frequency, period and duty cycle measurements of the signal on the
+ * AUX pin, one frame per gate, until any byte is received.
+ *
+ * Measurements run in the background without gaps between gates, so results
+ * come at the gate rate instead of taking over a second each.
+ *
+ * PC -> Bus Pirate: 0x1B, the gate time in milliseconds (MSB first, 10 or
+ * more).
+ *
+ * The Bus Pirate answers 0x00 if the gate time is too short, or 0x01 followed
+ * by 17 bytes frames, all values MSB first:
+ *  - status, bit 0 set if input capture missed edges and the timed periods
+ *    are not reliable, as happens with fast signals;
+ *  - rising edges counted during the gate (4 bytes);
+ *  - whole periods timed by input capture (4 bytes);
+ *  - total length of those periods, in 0.5us ticks (4 bytes);
+ *  - time the signal was high during those periods, in 0.5us ticks (4 bytes).
+ */
+static void binary_io_frequency_stream(void);
+
+#endif /* BP_ENABLE_FREQUENCY_STREAM */
+
+#ifdef BP_ENABLE_PIN_SEQUENCES
+
+/**
+ * Plays a buffer of pin states out at a fixed rate, optionally sampling the
+ * pins on the same ticks.
+ *
+ * Each pattern byte uses the pin layout of the bitbang pin commands, AUX,
+ * MOSI, CLK, MISO and CS in bits 4 to 0; the upper bits are ignored, power
+ * and pull-ups keep their current state.  Only the pins configured as outputs
+ * are driven, the others can be captured.
+ *
+ * PC -> Bus Pirate: 0x1C, the Timer3 prescaler (bits 0-1: 1, 8, 64, 256) and
+ * period (MSB first), one step lasting (period + 1) * prescaler instruction
+ * cycles (16MHz), the flags (bit 0 to loop until any byte is received, bit 1
+ * to capture the pins), and the pattern length (MSB first).
+ *
+ * The Bus Pirate answers 0x00 straight away if the step is shorter than 64
+ * cycles, if both flags are set, or if the length is 0 or larger than the
+ * terminal buffer (half of it when capturing), and no pattern is then
+ * expected.  Otherwise PC sends the pattern, the Bus Pirate plays it, and
+ * answers 0x01 once done or stopped.  When capturing, the answer is followed
+ * by one byte per step, in the same layout, holding the pins state read just
+ * before the step was driven.
+ */
+static void binary_io_pattern_generator(void);
+
+#endif /* BP_ENABLE_PIN_SEQUENCES */
+
+#ifdef BP_ENABLE_SOFTWARE_PWM
+
+/**
+ * Reads the software PWM duty cycles, MSB first, in channel order.
+ */
+static void software_pwm_read_duty_cycles(uint16_t *duty_cycles);
+
+#endif /* BP_ENABLE_SOFTWARE_PWM */
+
+#ifdef BP_ENABLE_PIN_SEQUENCES
+
+/**
+ * Runs a small program driving and sampling the pins, so that custom bit
+ * banged protocols run at microsecond rather than USB round trip timing.
+ *
+ * PC -> Bus Pirate: 0x1F, the program length (MSB first, 1 to 2048 bytes),
+ * then the program.  The Bus Pirate answers 0x00 if the length or the program
+ * is not valid, otherwise it runs the program and answers with the result
+ * (0x01 done, 0x02 samples buffer full, 0x03 stopped by the host), the number
+ * of samples taken (MSB first) and the samples.  See bitbang.md for the
+ * instruction set.
+ */
+static void binary_io_run_sequence(void);
+
+/**
+ * Applies a sequence of pin states back to back and returns all the pin
+ * reads together, rather than one round trip per 1xxxxxxx command.
+ *
+ * PC -> Bus Pirate: 0x20, the delay between setting the pins and reading
+ * them back in microseconds (MSB first), and the number of states (MSB first,
+ * 1 to 4096).  The Bus Pirate answers 0x00 straight away if the count is out
+ * of range, and no state is then expected.  Otherwise PC sends the states, in
+ * the 1xxxxxxx command layout, and the Bus Pirate answers 0x01 followed by one
+ * read per state, as the 1xxxxxxx command answers.
+ */
+static void binary_io_bulk_pin_states(void);
+
+#endif /* BP_ENABLE_PIN_SEQUENCES */
+
 // unsigned char binBBpindirectionset(unsigned char inByte);
 // unsigned char binBBpinset(unsigned char inByte);
 void binSelfTest(bool jumper_test);
@@ -96,12 +259,22 @@ Commands:
 00000101 //enter raw wire mode
 00000110 // enter openOCD
 00000111 // pic programming mode
+00001000 // enter raw SWD mode
 00001111 //reset, return to user terminal
 00010000 //short self test
 00010001 //full self test with jumpers
 00010010 // setup PWM
 00010011 // clear PWM
 00010100 // ADC measurement
+00010111 // Timer paced, packed ADC stream
+00011001 // Triggered oscilloscope frames
+00011010 // Timestamped voltage telemetry
+00011011 // Frequency, period and duty cycle stream
+00011100 // Pattern generator
+00011101 // Software PWM setup
+00011110 // Software PWM duty cycles update
+00011111 // Pin sequencer
+00100000 // Bulk pin states
 
 // Added JM  Only with BP4
 00010101 // ADC ....
@@ -178,6 +351,13 @@ void binBB(void) {
 #endif /* BP_ENABLE_PIC_SUPPORT */
         binReset();
         send_binary_io_mode_identifier();
+      } else if (inByte == 8) { // goto SWD mode
+        binReset();
+#ifdef BP_ENABLE_SWD_SUPPORT
+        binary_io_enter_swd_mode();
+#endif /* BP_ENABLE_SWD_SUPPORT */
+        binReset();
+        send_binary_io_mode_identifier();
       } else if (inByte == 0b1111) { // return to terminal
         user_serial_transmit_character(1);
         BP_LEDMODE = 0; // light MODE LED
@@ -251,6 +431,56 @@ void binBB(void) {
           }
         }
         AD1CON1bits.ADON = 0;         // turn ADC OFF
+#ifdef BP_ENABLE_ADC_STREAMS
+      } else if (inByte == 0b10111) { // timer paced ADC stream
+        binary_io_adc_stream();
+      } else if (inByte == 0b11001) { // triggered oscilloscope frames
+        binary_io_adc_scope();
+      } else if (inByte == 0b11010) { // timestamped voltage telemetry
+        binary_io_adc_telemetry();
+#endif /* BP_ENABLE_ADC_STREAMS */
+#ifdef BP_ENABLE_FREQUENCY_STREAM
+      } else if (inByte == 0b11011) { // frequency measurement stream
+        binary_io_frequency_stream();
+#endif /* BP_ENABLE_FREQUENCY_STREAM */
+#ifdef BP_ENABLE_PIN_SEQUENCES
+      } else if (inByte == 0b11100) { // pattern generator
+        binary_io_pattern_generator();
+#endif /* BP_ENABLE_PIN_SEQUENCES */
+#ifdef BP_ENABLE_SOFTWARE_PWM
+      } else if (inByte == 0b11101) { // software PWM setup
+        uint16_t duty_cycles[SOFTWARE_PWM_CHANNELS];
+        uint16_t period;
+        uint8_t prescaler;
+
+        prescaler = getRXbyte();
+        period = getRXbyte() << 8;
+        period |= getRXbyte();
+        software_pwm_read_duty_cycles(duty_cycles);
+        if (period == 0) {
+          bp_software_pwm_stop();
+          REPORT_IO_SUCCESS();
+        } else if (bp_software_pwm_start(prescaler, period, duty_cycles)) {
+          REPORT_IO_SUCCESS();
+        } else {
+          REPORT_IO_FAILURE();
+        }
+      } else if (inByte == 0b11110) { // software PWM duty cycles update
+        uint16_t duty_cycles[SOFTWARE_PWM_CHANNELS];
+
+        software_pwm_read_duty_cycles(duty_cycles);
+        if (bp_software_pwm_update(duty_cycles)) {
+          REPORT_IO_SUCCESS();
+        } else {
+          REPORT_IO_FAILURE();
+        }
+#endif /* BP_ENABLE_SOFTWARE_PWM */
+#ifdef BP_ENABLE_PIN_SEQUENCES
+      } else if (inByte == 0b11111) { // pin sequencer
+        binary_io_run_sequence();
+      } else if (inByte == 0b100000) { // bulk pin states
+        binary_io_bulk_pin_states();
+#endif /* BP_ENABLE_PIN_SEQUENCES */
       } else if (inByte == 0b10110) { // binary frequency count access
         unsigned long l;
         l = bp_measure_frequency();
@@ -278,12 +508,964 @@ void binBB(void) {
   }   // while
 } // function
 
+#ifdef BP_ENABLE_ADC_STREAMS
+
+/* Instruction cycles per conversion, 12 Tad plus sampling, with Tad = 3 Tcy. */
+#define ADC_STREAM_MINIMUM_PERIOD 48
+
+/* Samples in each half of the ADC result buffer. */
+#define ADC_STREAM_BLOCK_SAMPLES 8
+
+/* Sequence number plus 8 samples packed 4 per 5 bytes. */
+#define ADC_STREAM_BLOCK_SIZE 11
+
+/* Samples packed together, and the bytes they take. */
+#define ADC_PACKED_SAMPLES 4
+#define ADC_PACKED_SIZE 5
+
+/* Scope frame setup bytes after the timer settings. */
+#define ADC_SCOPE_SETUP_SIZE 8
+
+/* Longest scope frame, two bytes per sample in the terminal buffer. */
+#define ADC_SCOPE_MAXIMUM_SAMPLES (BP_TERMINAL_BUFFER_SIZE / 2)
+
+/* Scope trigger slopes. */
+#define ADC_SCOPE_FREE_RUNNING 0
+#define ADC_SCOPE_RISING 1
+#define ADC_SCOPE_FALLING 2
+
+/*
+ * Conversions triggered by Timer3 while streaming, counted by its interrupt
+ * so blocks lost while the serial link was busy are numbered correctly.
+ */
+static volatile uint16_t adc_stream_conversions;
+
+/*
+ * Reads the Timer3 prescaler and period, and sets up Timer3 to trigger ADC
+ * conversions on the voltage probe, with the interrupt flag raised every 8
+ * conversions alternating between ADC1BUF0-7 and ADC1BUF8-F.  The timer is
+ * left stopped.  Returns false if the period is shorter than a conversion.
+ */
+static bool adc_stream_setup(void) {
+  static const uint16_t prescalers[] = {1, 8, 64, 256};
+  uint8_t prescaler;
+  uint16_t period;
+
+  prescaler = getRXbyte() & 0b11;
+  period = getRXbyte() << 8;
+  period |= getRXbyte();
+  if (((uint32_t)period + 1) * prescalers[prescaler] <
+      ADC_STREAM_MINIMUM_PERIOD) {
+    return false;
+  }
+
+  /* Timer3 on its own, as the frequency counter may have chained it. */
+  T2CONbits.T32 = OFF;
+  T3CON = prescaler << _T3CON_TCKPS_POSITION;
+  TMR3 = 0;
+  PR3 = period;
+
+  /* Sample continuously and convert on Timer3 period match. */
+  AD1CHS = BP_ADC_PROBE;
+  AD1CON1bits.SSRC = 0b010;
+  AD1CON1bits.ASAM = ON;
+  AD1CON2 = 0x0000;
+  AD1CON2bits.SMPI = ADC_STREAM_BLOCK_SAMPLES - 1;
+  AD1CON2bits.BUFM = ON;
+  IFS0bits.AD1IF = OFF;
+  AD1CON1bits.ADON = ON;
+
+  return true;
+}
+
+/* Puts the ADC back in the single conversion setup used by bp_read_adc. */
+static void adc_stream_stop(void) {
+  T3CON = 0;
+  IEC0bits.T3IE = OFF;
+  IFS0bits.T3IF = OFF;
+  AD1CON1bits.ADON = OFF;
+  AD1CON1bits.ASAM = OFF;
+  AD1CON1bits.SSRC = 0b111;
+  AD1CON2 = 0x0000;
+}
+
+/*
+ * Returns the half of the ADC result buffer that was just filled, or NULL if
+ * the ADC is still filling it.
+ */
+static volatile uint16_t *adc_stream_block(void) {
+  if (!IFS0bits.AD1IF) {
+    return NULL;
+  }
+  IFS0bits.AD1IF = OFF;
+
+  /* BUFS tells which half the ADC is filling, the other one is ready. */
+  return AD1CON2bits.BUFS ? &ADC1BUF0 : &ADC1BUF8;
+}
+
+/*
+ * Packs a 10 bits sample in a group of four: the upper 8 bits of each sample
+ * first, then a byte holding the lower 2 bits of the four, first sample in the
+ * top bits.
+ */
+static void adc_pack_sample(uint8_t *group, const uint8_t index,
+                            const uint16_t sample) {
+  if (index == 0) {
+    group[ADC_PACKED_SAMPLES] = 0;
+  }
+  group[index] = sample >> 2;
+  group[ADC_PACKED_SAMPLES] |= (sample & 0b11) << (6 - (index * 2));
+}
+
+void binary_io_adc_stream(void) {
+  uint8_t block[ADC_STREAM_BLOCK_SIZE];
+  volatile uint16_t *results;
+  uint16_t conversions;
+  uint16_t completed;
+  uint8_t index;
+  bool filling_upper;
+
+  if (!adc_stream_setup()) {
+    REPORT_IO_FAILURE();
+    return;
+  }
+  REPORT_IO_SUCCESS();
+
+  adc_stream_conversions = 0;
+  IFS0bits.T3IF = OFF;
+  IPC2bits.T3IP = 4;
+  IEC0bits.T3IE = ON;
+  T3CONbits.TON = ON;
+
+  while (!user_serial_ready_to_read()) {
+    if (!IFS0bits.AD1IF) {
+      continue;
+    }
+    IFS0bits.AD1IF = OFF;
+
+    /* Take the count and the buffer half together. */
+    do {
+      conversions = adc_stream_conversions;
+      filling_upper = AD1CON2bits.BUFS;
+    } while (conversions != adc_stream_conversions);
+    results = filling_upper ? &ADC1BUF0 : &ADC1BUF8;
+
+    /*
+     * The last block triggered may still be converting, the block in the
+     * buffer is the latest one on the other half than the one being filled.
+     */
+    completed = (conversions / ADC_STREAM_BLOCK_SAMPLES) - 1;
+    if ((completed & 1) == filling_upper) {
+      completed--;
+    }
+
+    block[0] = completed;
+    for (index = 0; index < ADC_STREAM_BLOCK_SAMPLES; index++) {
+      adc_pack_sample(&block[1 + ((index / ADC_PACKED_SAMPLES) *
+                                  ADC_PACKED_SIZE)],
+                      index % ADC_PACKED_SAMPLES, results[index]);
+    }
+    bp_write_buffer(block, ADC_STREAM_BLOCK_SIZE);
+  }
+  user_serial_read_byte();
+
+  adc_stream_stop();
+}
+
+void __attribute__((interrupt, no_auto_psv)) _T3Interrupt(void) {
+  adc_stream_conversions++;
+  IFS0bits.T3IF = OFF;
+}
+
+void binary_io_adc_scope(void) {
+  uint8_t setup[ADC_SCOPE_SETUP_SIZE];
+  uint8_t group[ADC_PACKED_SIZE];
+  uint8_t *ring;
+  volatile uint16_t *results;
+  uint16_t samples;
+  uint16_t pretrigger;
+  uint16_t level;
+  uint16_t holdoff;
+  uint16_t position;
+  uint16_t stored;
+  uint16_t remaining;
+  uint16_t sample;
+  uint16_t previous;
+  uint16_t index;
+  uint8_t slope;
+  bool triggered;
+  bool discard;
+
+  if (!adc_stream_setup()) {
+    for (index = 0; index < ADC_SCOPE_SETUP_SIZE; index++) {
+      getRXbyte();
+    }
+    REPORT_IO_FAILURE();
+    return;
+  }
+  for (index = 0; index < ADC_SCOPE_SETUP_SIZE; index++) {
+    setup[index] = getRXbyte();
+  }
+  samples = (setup[0] << 8) | setup[1];
+  level = (setup[3] << 8) | setup[4];
+  slope = setup[5];
+  holdoff = (setup[6] << 8) | setup[7];
+  if ((samples == 0) || (samples % ADC_PACKED_SAMPLES) ||
+      (samples > ADC_SCOPE_MAXIMUM_SAMPLES) || (setup[2] > 100) ||
+      (slope > ADC_SCOPE_FALLING)) {
+    adc_stream_stop();
+    REPORT_IO_FAILURE();
+    return;
+  }
+
+  /* The trigger sample itself is always part of the frame. */
+  pretrigger = ((uint32_t)samples * setup[2]) / 100;
+  if (pretrigger == samples) {
+    pretrigger--;
+  }
+  if (holdoff < pretrigger) {
+    holdoff = pretrigger;
+  }
+
+  ring = bus_pirate_configuration.terminal_input;
+  REPORT_IO_SUCCESS();
+
+  while (!user_serial_ready_to_read()) {
+    /* Refill the pretrigger part from scratch for every frame. */
+    position = 0;
+    stored = 0;
+    remaining = 0;
+    previous = level;
+    triggered = false;
+    discard = true;
+    IFS0bits.AD1IF = OFF;
+    TMR3 = 0;
+    T3CONbits.TON = ON;
+
+    while ((!triggered || (remaining > 0)) && !user_serial_ready_to_read()) {
+      results = adc_stream_block();
+      if (results == NULL) {
+        continue;
+      }
+
+      /* The first block may hold samples left from the previous frame. */
+      if (discard) {
+        discard = false;
+        continue;
+      }
+
+      for (index = 0; index < ADC_STREAM_BLOCK_SAMPLES; index++) {
+        sample = results[index];
+        if (triggered) {
+          if (remaining == 0) {
+            break;
+          }
+          remaining--;
+        } else if (stored >= holdoff) {
+          switch (slope) {
+          case ADC_SCOPE_RISING:
+            triggered = (previous < level) && (sample >= level);
+            break;
+
+          case ADC_SCOPE_FALLING:
+            triggered = (previous > level) && (sample <= level);
+            break;
+
+          default:
+            triggered = true;
+            break;
+          }
+          if (triggered) {
+            remaining = samples - pretrigger - 1;
+          }
+        }
+        previous = sample;
+
+        ring[position * 2] = sample >> 8;
+        ring[(position * 2) + 1] = sample;
+        if (++position == samples) {
+          position = 0;
+        }
+        if (stored < holdoff) {
+          stored++;
+        }
+      }
+    }
+    T3CONbits.TON = OFF;
+
+    if (!triggered || (remaining > 0)) {
+      break;
+    }
+
+    /* The oldest sample is the one the next write would have replaced. */
+    user_serial_transmit_character(0x01);
+    for (index = 0; index < samples; index++) {
+      adc_pack_sample(group, index % ADC_PACKED_SAMPLES,
+                      (ring[position * 2] << 8) | ring[(position * 2) + 1]);
+      if (++position == samples) {
+        position = 0;
+      }
+      if ((index % ADC_PACKED_SAMPLES) == (ADC_PACKED_SAMPLES - 1)) {
+        bp_write_buffer(group, ADC_PACKED_SIZE);
+      }
+    }
+  }
+  user_serial_read_byte();
+  user_serial_transmit_character(0x00);
+
+  adc_stream_stop();
+}
+
+/* Instruction cycles per scan of the four voltage channels, 4 * 43 Tad. */
+#define ADC_TELEMETRY_MINIMUM_PERIOD 600
+
+/* Timestamp plus 4 samples packed in 5 bytes. */
+#define ADC_TELEMETRY_FRAME_SIZE 9
+
+static uint32_t adc_telemetry_timestamp(void) {
+  uint16_t low;
+
+  /* Reading TMR2 latches TMR3 into TMR3HLD. */
+  low = TMR2;
+  return ((uint32_t)TMR3HLD << 16) | low;
+}
+
+void binary_io_adc_telemetry(void) {
+  static const uint16_t prescalers[] = {1, 8, 64, 256};
+  uint8_t frame[ADC_TELEMETRY_FRAME_SIZE];
+  bp_adc_channels_t readings;
+  uint32_t timestamp;
+  uint32_t next;
+  uint16_t interval;
+  uint8_t prescaler;
+
+  prescaler = getRXbyte() & 0b11;
+  interval = getRXbyte() << 8;
+  interval |= getRXbyte();
+  if ((uint32_t)interval * prescalers[prescaler] <
+      ADC_TELEMETRY_MINIMUM_PERIOD) {
+    REPORT_IO_FAILURE();
+    return;
+  }
+
+  /* Timer2 and Timer3 chained, counting from zero up to 0xFFFFFFFF. */
+  T2CON = 0;
+  T3CON = 0;
+  T2CON = (ON << _T2CON_T32_POSITION) | (prescaler << _T2CON_TCKPS_POSITION);
+  PR3 = 0xFFFF;
+  PR2 = 0xFFFF;
+  TMR3HLD = 0;
+  TMR2 = 0;
+  AD1CON1bits.ADON = ON;
+
+  REPORT_IO_SUCCESS();
+  T2CONbits.TON = ON;
+
+  next = 0;
+  while (!user_serial_ready_to_read()) {
+    timestamp = adc_telemetry_timestamp();
+    if ((int32_t)(timestamp - next) < 0) {
+      continue;
+    }
+
+    /* Fall back in step if the link made the previous frames late. */
+    next += interval;
+    if ((int32_t)(timestamp - next) >= 0) {
+      next = timestamp + interval;
+    }
+
+    bp_read_adc_channels(&readings);
+    frame[0] = timestamp >> 24;
+    frame[1] = timestamp >> 16;
+    frame[2] = timestamp >> 8;
+    frame[3] = timestamp;
+    adc_pack_sample(&frame[4], 0, readings.probe);
+    adc_pack_sample(&frame[4], 1, readings.pullup);
+    adc_pack_sample(&frame[4], 2, readings.supply_3v3);
+    adc_pack_sample(&frame[4], 3, readings.supply_5v0);
+    bp_write_buffer(frame, ADC_TELEMETRY_FRAME_SIZE);
+  }
+  user_serial_read_byte();
+
+  T2CON = 0;
+  AD1CON1bits.ADON = OFF;
+}
+
+#endif /* BP_ENABLE_ADC_STREAMS */
+
+#ifdef BP_ENABLE_FREQUENCY_STREAM
+
+/* Shortest gate time for the frequency stream, in milliseconds. */
+#define FREQUENCY_STREAM_MINIMUM_GATE 10
+
+/* Status byte plus four 32 bits values. */
+#define FREQUENCY_STREAM_FRAME_SIZE 17
+
+static void pack_uint32(uint8_t *buffer, const uint32_t value) {
+  buffer[0] = value >> 24;
+  buffer[1] = value >> 16;
+  buffer[2] = value >> 8;
+  buffer[3] = value;
+}
+
+void binary_io_frequency_stream(void) {
+  uint8_t frame[FREQUENCY_STREAM_FRAME_SIZE];
+  bp_frequency_measurement_t measurement;
+  uint32_t gate_ticks;
+  uint16_t gate;
+
+  gate = getRXbyte() << 8;
+  gate |= getRXbyte();
+  if (gate < FREQUENCY_STREAM_MINIMUM_GATE) {
+    REPORT_IO_FAILURE();
+    return;
+  }
+  gate_ticks = gate * (FREQUENCY_MEASUREMENT_TICKS_PER_SECOND / 1000);
+
+  bp_frequency_measurement_start();
+  REPORT_IO_SUCCESS();
+
+  while (!user_serial_ready_to_read()) {
+    if (!bp_frequency_measurement_poll(gate_ticks, &measurement)) {
+      continue;
+    }
+
+    frame[0] = measurement.overflow ? 0x01 : 0x00;
+    pack_uint32(&frame[1], measurement.edges);
+    pack_uint32(&frame[5], measurement.periods);
+    pack_uint32(&frame[9], measurement.period_ticks);
+    pack_uint32(&frame[13], measurement.high_ticks);
+    bp_write_buffer(frame, FREQUENCY_STREAM_FRAME_SIZE);
+  }
+  user_serial_read_byte();
+
+  bp_frequency_measurement_stop();
+}
+
+#endif /* BP_ENABLE_FREQUENCY_STREAM */
+
+#ifdef BP_ENABLE_PIN_SEQUENCES
+
+/* Shortest pattern step, in instruction cycles. */
+#define PATTERN_MINIMUM_PERIOD 64
+
+/* Pattern flags. */
+#define PATTERN_LOOP 0b01
+#define PATTERN_CAPTURE 0b10
+
+/* Pins driven by a pattern, in the bitbang pin command layout. */
+#define PATTERN_PINS_COUNT 5
+#define PATTERN_PINS (AUX | MOSI | CLK | MISO | CS)
+
+/* Converts a port value to the bitbang pin command layout. */
+static uint8_t pattern_read_pins(const uint16_t port) {
+  uint8_t pins = 0;
+
+  if (port & AUX) {
+    pins |= 0b10000;
+  }
+  if (port & MOSI) {
+    pins |= 0b1000;
+  }
+  if (port & CLK) {
+    pins |= 0b100;
+  }
+  if (port & MISO) {
+    pins |= 0b10;
+  }
+  if (port & CS) {
+    pins |= 0b1;
+  }
+
+  return pins;
+}
+
+/*
+ * Takes the pins over from the software PWM, whose interrupt would otherwise
+ * keep writing the same latches.
+ */
+static void pattern_claim_pins(void) {
+#ifdef BP_ENABLE_SOFTWARE_PWM
+  bp_software_pwm_stop();
+#endif /* BP_ENABLE_SOFTWARE_PWM */
+}
+
+/* Fills the port bits for every value in the bitbang pin command layout. */
+static void pattern_build_latches(uint16_t *latches) {
+  static const uint16_t pin_masks[PATTERN_PINS_COUNT] = {CS, MISO, CLK, MOSI,
+                                                         AUX};
+  uint8_t index;
+  uint8_t bit;
+
+  for (index = 0; index < (1 << PATTERN_PINS_COUNT); index++) {
+    latches[index] = 0;
+    for (bit = 0; bit < PATTERN_PINS_COUNT; bit++) {
+      if (index & (1 << bit)) {
+        latches[index] |= pin_masks[bit];
+      }
+    }
+  }
+}
+
+void binary_io_pattern_generator(void) {
+  static const uint16_t prescalers[] = {1, 8, 64, 256};
+  uint16_t latches[1 << PATTERN_PINS_COUNT];
+  uint8_t *pattern;
+  uint8_t *capture;
+  uint8_t prescaler;
+  uint8_t flags;
+  uint16_t period;
+  uint16_t length;
+  uint16_t index;
+
+  prescaler = getRXbyte() & 0b11;
+  period = getRXbyte() << 8;
+  period |= getRXbyte();
+  flags = getRXbyte();
+  length = getRXbyte() << 8;
+  length |= getRXbyte();
+  if ((((uint32_t)period + 1) * prescalers[prescaler] <
+       PATTERN_MINIMUM_PERIOD) ||
+      ((flags & PATTERN_LOOP) && (flags & PATTERN_CAPTURE)) || (length == 0) ||
+      (length > ((flags & PATTERN_CAPTURE) ? BP_TERMINAL_BUFFER_SIZE / 2
+                                           : BP_TERMINAL_BUFFER_SIZE))) {
+    REPORT_IO_FAILURE();
+    return;
+  }
+
+  pattern = bus_pirate_configuration.terminal_input;
+  capture = &pattern[length];
+  for (index = 0; index < length; index++) {
+    pattern[index] = getRXbyte();
+  }
+
+  pattern_claim_pins();
+
+  /* Latch bits for every pattern value, so each step is a single write. */
+  pattern_build_latches(latches);
+
+  T2CONbits.T32 = OFF;
+  T3CON = prescaler << _T3CON_TCKPS_POSITION;
+  TMR3 = 0;
+  PR3 = period;
+  IFS0bits.T3IF = OFF;
+  T3CONbits.TON = ON;
+
+  index = 0;
+  while (1) {
+    while (IFS0bits.T3IF == OFF) {
+    }
+    IFS0bits.T3IF = OFF;
+
+    if (flags & PATTERN_CAPTURE) {
+      capture[index] = pattern_read_pins(IOPOR);
+    }
+    IOLAT = (IOLAT & ~PATTERN_PINS) |
+            latches[pattern[index] & ((1 << PATTERN_PINS_COUNT) - 1)];
+
+    if (++index == length) {
+      /* The host is only checked once per pass, keeping every step even. */
+      if (!(flags & PATTERN_LOOP) || user_serial_ready_to_read()) {
+        break;
+      }
+      index = 0;
+    }
+  }
+
+  /* Let the last step last as long as the others. */
+  while (IFS0bits.T3IF == OFF) {
+  }
+  T3CON = 0;
+
+  if (flags & PATTERN_LOOP) {
+    user_serial_read_byte();
+  }
+  REPORT_IO_SUCCESS();
+  if (flags & PATTERN_CAPTURE) {
+    bp_write_buffer(capture, length);
+  }
+}
+
+#endif /* BP_ENABLE_PIN_SEQUENCES */
+
+#ifdef BP_ENABLE_SOFTWARE_PWM
+
+void software_pwm_read_duty_cycles(uint16_t *duty_cycles) {
+  uint8_t channel;
+
+  for (channel = 0; channel < SOFTWARE_PWM_CHANNELS; channel++) {
+    duty_cycles[channel] = getRXbyte() << 8;
+    duty_cycles[channel] |= getRXbyte();
+  }
+}
+
+#endif /* BP_ENABLE_SOFTWARE_PWM */
+
+#ifdef BP_ENABLE_PIN_SEQUENCES
+
+/* Sequencer instructions, see binary_io_run_sequence. */
+#define SEQUENCER_END 0x00
+#define SEQUENCER_WRITE 0x01
+#define SEQUENCER_SET 0x02
+#define SEQUENCER_CLEAR 0x03
+#define SEQUENCER_TOGGLE 0x04
+#define SEQUENCER_DIRECTION 0x05
+#define SEQUENCER_SAMPLE 0x06
+#define SEQUENCER_DELAY_CYCLES 0x07
+#define SEQUENCER_DELAY_US 0x08
+#define SEQUENCER_LOAD 0x09
+#define SEQUENCER_LOOP 0x0A
+#define SEQUENCER_JUMP 0x0B
+#define SEQUENCER_JUMP_IF_HIGH 0x0C
+#define SEQUENCER_JUMP_IF_LOW 0x0D
+#define SEQUENCER_WAIT 0x0E
+#define SEQUENCER_INSTRUCTIONS_COUNT 0x0F
+
+/* Sequencer results. */
+#define SEQUENCER_DONE 0x01
+#define SEQUENCER_SAMPLES_FULL 0x02
+#define SEQUENCER_ABORTED 0x03
+
+/* Loop counters available to a sequence. */
+#define SEQUENCER_COUNTERS 4
+
+/* Program and samples each get half of the terminal buffer. */
+#define SEQUENCER_MAXIMUM_LENGTH (BP_TERMINAL_BUFFER_SIZE / 2)
+
+/* Backward jumps taken between two checks for a host byte, minus one. */
+#define SEQUENCER_ABORT_CHECK_MASK 0xFF
+
+/* Timer4 ticks per microsecond, with a 1:8 prescaler. */
+#define SEQUENCER_TICKS_PER_US 2
+
+/* Shortest busy wait __delay32 can do, in instruction cycles. */
+#define SEQUENCER_MINIMUM_DELAY_CYCLES 12
+
+/*
+ * Checks every instruction is known and complete, and that jumps land on the
+ * start of an instruction.  The map of instruction starts is kept in the
+ * samples buffer, which is not in use yet.
+ */
+static bool sequencer_validate(const uint8_t *program, const uint16_t length,
+                               uint8_t *starts) {
+  static const uint8_t operands[SEQUENCER_INSTRUCTIONS_COUNT] = {
+      0, 1, 1, 1, 1, 1, 0, 2, 2, 3, 3, 2, 3, 3, 6};
+  uint16_t offset;
+  uint16_t target;
+  uint8_t opcode;
+  uint8_t loaded;
+
+  memset(starts, 0, (length + 7) / 8);
+  for (offset = 0; offset < length; offset += operands[opcode] + 1) {
+    opcode = program[offset];
+    if ((opcode >= SEQUENCER_INSTRUCTIONS_COUNT) ||
+        ((offset + operands[opcode]) >= length)) {
+      return false;
+    }
+    starts[offset / 8] |= 1 << (offset % 8);
+  }
+
+  /* A loop must come after a load of its counter, or it would wrap from 0. */
+  loaded = 0;
+  for (offset = 0; offset < length; offset += operands[opcode] + 1) {
+    opcode = program[offset];
+    switch (opcode) {
+    case SEQUENCER_LOAD:
+      if (program[offset + 1] >= SEQUENCER_COUNTERS) {
+        return false;
+      }
+      loaded |= 1 << program[offset + 1];
+      continue;
+
+    case SEQUENCER_LOOP:
+      if ((program[offset + 1] >= SEQUENCER_COUNTERS) ||
+          !(loaded & (1 << program[offset + 1]))) {
+        return false;
+      }
+    /* Fall through. */
+    case SEQUENCER_JUMP_IF_HIGH:
+    case SEQUENCER_JUMP_IF_LOW:
+      target = (program[offset + 2] << 8) | program[offset + 3];
+      break;
+
+    case SEQUENCER_JUMP:
+      target = (program[offset + 1] << 8) | program[offset + 2];
+      break;
+
+    case SEQUENCER_WAIT:
+      target = (program[offset + 5] << 8) | program[offset + 6];
+      break;
+
+    default:
+      continue;
+    }
+
+    if ((target >= length) || !(starts[target / 8] & (1 << (target % 8)))) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+/*
+ * Waits until the masked pins match the given level, or for the given time.
+ * A zero mask never matches, making it a plain delay.
+ */
+static bool sequencer_wait(const uint16_t mask, const uint16_t level,
+                           const uint32_t ticks) {
+  uint32_t elapsed;
+  uint16_t last;
+  uint16_t now;
+
+  elapsed = 0;
+  last = TMR4;
+  do {
+    if ((mask != 0) && ((IOPOR & mask) == level)) {
+      return true;
+    }
+    now = TMR4;
+    elapsed += (uint16_t)(now - last);
+    last = now;
+  } while (elapsed < ticks);
+
+  return false;
+}
+
+void binary_io_run_sequence(void) {
+  uint16_t latches[1 << PATTERN_PINS_COUNT];
+  uint16_t counters[SEQUENCER_COUNTERS];
+  uint8_t *program;
+  uint8_t *samples;
+  uint16_t length;
+  uint16_t count;
+  uint16_t pc;
+  uint16_t operand;
+  uint8_t *instruction;
+  uint8_t checks;
+  uint8_t result;
+
+  length = getRXbyte() << 8;
+  length |= getRXbyte();
+  if ((length == 0) || (length > SEQUENCER_MAXIMUM_LENGTH)) {
+    REPORT_IO_FAILURE();
+    return;
+  }
+
+  program = bus_pirate_configuration.terminal_input;
+  samples = &program[SEQUENCER_MAXIMUM_LENGTH];
+  for (pc = 0; pc < length; pc++) {
+    program[pc] = getRXbyte();
+  }
+  if (!sequencer_validate(program, length, samples)) {
+    REPORT_IO_FAILURE();
+    return;
+  }
+
+  pattern_claim_pins();
+  pattern_build_latches(latches);
+  memset(counters, 0, sizeof(counters));
+
+  /* Timer4 free runs at 2MHz for the microsecond delays and timeouts. */
+  T4CON = 0b01 << _T4CON_TCKPS_POSITION;
+  TMR4 = 0;
+  PR4 = 0xFFFF;
+  T4CONbits.TON = ON;
+
+  count = 0;
+  checks = 0;
+  pc = 0;
+  result = SEQUENCER_DONE;
+  while (pc < length) {
+    instruction = &program[pc];
+    switch (instruction[0]) {
+    case SEQUENCER_END:
+      pc = length;
+      continue;
+
+    case SEQUENCER_WRITE:
+      IOLAT = (IOLAT & ~PATTERN_PINS) | latches[instruction[1] & 0b11111];
+      pc += 2;
+      continue;
+
+    case SEQUENCER_SET:
+      IOLAT |= latches[instruction[1] & 0b11111];
+      pc += 2;
+      continue;
+
+    case SEQUENCER_CLEAR:
+      IOLAT &= ~latches[instruction[1] & 0b11111];
+      pc += 2;
+      continue;
+
+    case SEQUENCER_TOGGLE:
+      IOLAT ^= latches[instruction[1] & 0b11111];
+      pc += 2;
+      continue;
+
+    case SEQUENCER_DIRECTION:
+      binBBpindirectionset(instruction[1]);
+      pc += 2;
+      continue;
+
+    case SEQUENCER_SAMPLE:
+      if (count == SEQUENCER_MAXIMUM_LENGTH) {
+        result = SEQUENCER_SAMPLES_FULL;
+        break;
+      }
+      samples[count++] = pattern_read_pins(IOPOR);
+      pc += 1;
+      continue;
+
+    case SEQUENCER_DELAY_CYCLES:
+      operand = (instruction[1] << 8) | instruction[2];
+      if (operand >= SEQUENCER_MINIMUM_DELAY_CYCLES) {
+        __delay32(operand);
+      }
+      pc += 3;
+      continue;
+
+    case SEQUENCER_DELAY_US:
+      operand = (instruction[1] << 8) | instruction[2];
+      sequencer_wait(0, 0, (uint32_t)operand * SEQUENCER_TICKS_PER_US);
+      pc += 3;
+      continue;
+
+    case SEQUENCER_LOAD:
+      counters[instruction[1]] = (instruction[2] << 8) | instruction[3];
+      pc += 4;
+      continue;
+
+    case SEQUENCER_LOOP:
+      operand = (instruction[2] << 8) | instruction[3];
+      pc = (--counters[instruction[1]] != 0) ? operand : pc + 4;
+      break;
+
+    case SEQUENCER_JUMP:
+      pc = (instruction[1] << 8) | instruction[2];
+      break;
+
+    case SEQUENCER_JUMP_IF_HIGH:
+      operand = (instruction[2] << 8) | instruction[3];
+      pc = (IOPOR & latches[instruction[1] & 0b11111]) ? operand : pc + 4;
+      break;
+
+    case SEQUENCER_JUMP_IF_LOW:
+      operand = (instruction[2] << 8) | instruction[3];
+      pc = (IOPOR & latches[instruction[1] & 0b11111]) ? pc + 4 : operand;
+      break;
+
+    case SEQUENCER_WAIT:
+      operand = (instruction[3] << 8) | instruction[4];
+      pc = sequencer_wait(latches[instruction[1] & 0b11111],
+                          latches[instruction[1] & instruction[2] & 0b11111],
+                          (uint32_t)operand * SEQUENCER_TICKS_PER_US)
+               ? pc + 7
+               : (instruction[5] << 8) | instruction[6];
+      break;
+    }
+
+    if (result != SEQUENCER_DONE) {
+      break;
+    }
+
+    /* Only jumps get here, let the host stop a sequence that never ends. */
+    if ((pc <= (uint16_t)(instruction - program)) &&
+        ((++checks & SEQUENCER_ABORT_CHECK_MASK) == 0) &&
+        user_serial_ready_to_read()) {
+      user_serial_read_byte();
+      result = SEQUENCER_ABORTED;
+      break;
+    }
+  }
+
+  T4CON = 0;
+
+  user_serial_transmit_character(result);
+  user_serial_transmit_character(count >> 8);
+  user_serial_transmit_character(count & 0xFF);
+  bp_write_buffer(samples, count);
+}
+
+/* Pin state bits that are not AUX|MOSI|CLK|MISO|CS. */
+#define BULK_PINS_POWER 0b1000000
+#define BULK_PINS_PULLUP 0b100000
+
+void binary_io_bulk_pin_states(void) {
+  uint16_t latches[1 << PATTERN_PINS_COUNT];
+  uint8_t *states;
+  uint32_t delay;
+  uint16_t count;
+  uint16_t index;
+  uint8_t state;
+  uint8_t previous;
+
+  delay = getRXbyte() << 8;
+  delay |= getRXbyte();
+  count = getRXbyte() << 8;
+  count |= getRXbyte();
+  if ((count == 0) || (count > BP_TERMINAL_BUFFER_SIZE)) {
+    REPORT_IO_FAILURE();
+    return;
+  }
+
+  states = bus_pirate_configuration.terminal_input;
+  for (index = 0; index < count; index++) {
+    states[index] = getRXbyte();
+  }
+
+  pattern_claim_pins();
+  pattern_build_latches(latches);
+  delay *= FCY / 1000000UL;
+
+  /* Force the power and pull-up state on the first step. */
+  previous = ~states[0];
+  for (index = 0; index < count; index++) {
+    state = states[index];
+
+    if ((state ^ previous) & BULK_PINS_POWER) {
+      if (state & BULK_PINS_POWER) {
+        BP_VREG_ON();
+      } else {
+        BP_VREG_OFF();
+      }
+    }
+    if ((state ^ previous) & BULK_PINS_PULLUP) {
+      if (state & BULK_PINS_PULLUP) {
+        BP_PULLUP_ON();
+      } else {
+        BP_PULLUP_OFF();
+      }
+    }
+    previous = state;
+
+    /* All pins change together, unlike with binBBpinset. */
+    IOLAT = (IOLAT & ~PATTERN_PINS) |
+            latches[state & ((1 << PATTERN_PINS_COUNT) - 1)];
+    if (delay >= SEQUENCER_MINIMUM_DELAY_CYCLES) {
+      __delay32(delay);
+    }
+
+    /* The read replaces the state, as the 1xxxxxxx command answers. */
+    states[index] = (state & ~((1 << PATTERN_PINS_COUNT) - 1)) |
+                    pattern_read_pins(IOPOR);
+  }
+
+  REPORT_IO_SUCCESS();
+  bp_write_buffer(states, count);
+}
+
+#endif /* BP_ENABLE_PIN_SEQUENCES */
+
 unsigned char getRXbyte(void) {
   // JTR Not required while (UART1RXRdy() == 0); //wait for a byte
   return user_serial_read_byte(); ///* JTR usb port; */ //grab it
 }
 
 void binReset(void) {
+#ifdef BP_ENABLE_SOFTWARE_PWM
+  bp_software_pwm_stop();
+#endif /* BP_ENABLE_SOFTWARE_PWM */
 #if defined(BUSPIRATEV4) // Shut down the pull up voltages
   BP_3V3PU_OFF();
 #endif
@@ -565,6 +1747,14 @@ void PIC424Read(void);
  * 0100wxyz � Configure peripherals, w=power, x=pullups, y=AUX, z=CS
  * 0101xxxx - Bulk read, read 1-16bytes (0=1byte!)
  * 0110000x � Set speed
+ * 01110000 - Long bulk transfer, 16-bit length, status byte at the end
+ * 01110001 - Long bulk read, 16-bit length, status byte then data
+ * 10100000 - Set PIC programming mode (PIC416, PIC424, PIC614)
+ * 10100001 - PIC24 programming executive command, response streamed back
+ * 10100100 - PIC write commands
+ * 10100101 - PIC read commands
+ * 10100110 - PIC row programming, descriptor and row data
+ * 10100111 - PIC x write, y read commands
  * 1000wxyz � Config, w=output type, x=3wire, y=lsb, z=n/a
  ****************** BPv4 Specific Instructions *********************
  * 11110000 - Return SMPS output voltage
@@ -581,6 +1771,115 @@ enum {
     PIC614,
 };
 
+/**
+ * Raw-wire command for a long bulk write (and read, in 3-wire mode).
+ */
+#define RAW_WIRE_LONG_BULK_TRANSFER 0b01110000
+
+/**
+ * Raw-wire command for a long bulk read.
+ */
+#define RAW_WIRE_LONG_BULK_READ 0b01110001
+
+/**
+ * Transfers a long block of data on the raw-wire bus with no per-byte
+ * acknowledgement.
+ *
+ * The transfer length is read as a big-endian 16 bits value and must be
+ * between 1 and BP_TERMINAL_BUFFER_SIZE bytes.  An invalid length is refused
+ * right away with a failure code and no data is then expected.
+ *
+ * <b>Long bulk transfer (0x70):</b>
+ *
+ * PC -> Bus Pirate: 0x70, length MSB, length LSB, then length bytes.
+ * Bus Pirate -> PC: 0x01 once all bytes are clocked out, followed by the
+ * bytes clocked in if 3-wire mode is active.
+ *
+ * <b>Long bulk read (0x71):</b>
+ *
+ * PC -> Bus Pirate: 0x71, length MSB, length LSB.
+ * Bus Pirate -> PC: 0x01, followed by length bytes read from the bus.
+ *
+ * In both cases the read data is returned in a single burst, and bit order
+ * conversion is applied to the whole buffer in place.
+ *
+ * @param[in] command the raw-wire command byte.
+ * @param[in] three_wire true if the bus is in 3-wire mode, false otherwise.
+ */
+static void raw_wire_long_bulk_transfer(const uint8_t command,
+                                        const bool three_wire);
+
+/**
+ * Raw-wire PIC extension command for programming a whole row at once.
+ */
+#define RAW_WIRE_PIC_ROW_PROGRAM 0b10100110
+
+/**
+ * Programs a row of PIC memory, running the whole ICSP sequence on the Bus
+ * Pirate instead of one host exchange per command.
+ *
+ * The host describes the programming algorithm with lists of write entries,
+ * in the same layout used by the x write, y read command without the leading
+ * 0x01: command, data low, data high for PIC416 and PIC614 (the PIC416 delay
+ * bits and the PIC614 no data bit work as usual), or three instruction bytes
+ * and a post-instruction NOP count for PIC424.
+ *
+ * PC -> Bus Pirate: 0xA6, followed by a 9 bytes header:
+ *  - group size, the number of words loaded between two runs of the group
+ *    list (1-255, 1-16 for PIC424 as words go to W0-W15);
+ *  - load command, used for every word but the last one (PIC416/PIC614);
+ *  - last command, used for the last word of the row (PIC416/PIC614);
+ *  - group, program and next list entry counts;
+ *  - programming delay in milliseconds;
+ *  - word count (MSB first, 1 or more).
+ *
+ * Then the group, program and next lists, and the row data as two bytes per
+ * word.  For PIC416 and PIC614 these are the data low and data high bytes of
+ * the load command.  For PIC424 they are the word value, least significant
+ * byte first, that gets loaded with a MOV #word, Wn instruction, W0 to W(group
+ * size - 1) being filled in turn.
+ *
+ * The Bus Pirate answers 0x00 straight away if the header is invalid or the
+ * lists and data do not fit in the terminal buffer, and no more data is then
+ * expected.  Otherwise every word is loaded, the group list is run after each
+ * group of words but the last, then the program list is run, followed by the
+ * programming delay and the next list.  The Bus Pirate answers 0x01 at the
+ * end.
+ *
+ * @param[in] pic_mode the current PIC programming mode.
+ */
+static void raw_wire_pic_program_row(const uint8_t pic_mode);
+
+/**
+ * Raw-wire PIC extension command for a programming executive exchange.
+ */
+#define RAW_WIRE_PIC_PE_COMMAND 0b10100001
+
+/**
+ * Sends a command packet to the PIC24 programming executive and streams its
+ * response back, so whole blocks are moved with PROGP/READP instead of one
+ * SIX/REGOUT sequence per word.
+ *
+ * The device must already be in Enhanced ICSP mode, with the executive
+ * loaded in executive memory (with row programming) and the MCHP key sent
+ * through the regular raw-wire commands.  Only valid in PIC424 mode with
+ * 2-wire output, as PGD is both written and read on MOSI.
+ *
+ * PC -> Bus Pirate: 0xA1, word count (MSB first, 1 or more), then the command
+ * packet words, MSB first, as defined by the executive: opcode and length in
+ * the first word, followed by the command arguments and data.
+ *
+ * The Bus Pirate answers 0x00 straight away if the mode or the word count is
+ * invalid, and no more data is then expected.  Otherwise the packet is clocked
+ * out, PGD is released and the Bus Pirate waits for the executive to pull it
+ * low.  If that does not happen in time it answers 0x00, otherwise it answers
+ * 0x01 followed by the whole response, MSB first: the opcode/QE code word, the
+ * length word and the data words, as they are clocked in.
+ *
+ * @param[in] pic_mode the current PIC programming mode.
+ */
+static void raw_wire_pic_pe_command(const uint8_t pic_mode);
+
 void binwire(void) {
     static unsigned char inByte, rawCommand, i, c, wires, picMode = PIC614;
     static unsigned int cmds, cmdw, cmdr, j;
@@ -644,7 +1943,7 @@ void binwire(void) {
                             i = bitbang_read_with_write(0xff);
                         }
                         if (mode_configuration.lsbEN == 1) {//adjust bitorder
-                            i = bp_reverse_integer(i, mode_configuration.numbits);
+                            i = bp_reverse_byte(i);
                         }
                         user_serial_transmit_character(i);
                         break;
@@ -688,7 +1987,7 @@ void binwire(void) {
                 for (i = 0; i < inByte; i++) {
                     c = user_serial_read_byte(); // /* JTR usb port; */;
                     if (mode_configuration.lsbEN == 1) {//adjust bitorder
-                        c = bp_reverse_integer(c, mode_configuration.numbits);
+                        c = bp_reverse_byte(c);
                     }
                     if (wires == 2) {//2 wire, send 1
                         bitbang_write_value(c); //send byte
@@ -696,7 +1995,7 @@ void binwire(void) {
                     } else { //3 wire, return read byte
                         c = bitbang_read_with_write(c); //send byte
                         if (mode_configuration.lsbEN == 1) {//adjust bitorder
-                            c = bp_reverse_integer(c, mode_configuration.numbits);
+                            c = bp_reverse_byte(c);
                         }
                         user_serial_transmit_character(c);
                     }
@@ -839,6 +2138,12 @@ void binwire(void) {
                                 break;
                         }
                         break;
+                    case RAW_WIRE_PIC_PE_COMMAND:
+                        raw_wire_pic_pe_command(picMode);
+                        break;
+                    case RAW_WIRE_PIC_ROW_PROGRAM:
+                        raw_wire_pic_program_row(picMode);
+                        break;
                     case 0b10100111: // x write, y read commands.
                         cmdw = user_serial_read_byte();
                         cmdr = user_serial_read_byte();
@@ -901,6 +2206,19 @@ void binwire(void) {
 
                 //case 0b0101: //# 0101xxxx - Bulk read, read 1-16bytes (0=1byte!)
 
+            case 0b0111: //long bulk transfers
+                switch (inByte) {
+                    case RAW_WIRE_LONG_BULK_TRANSFER:
+                    case RAW_WIRE_LONG_BULK_READ:
+                        raw_wire_long_bulk_transfer(inByte, wires == 3);
+                        break;
+
+                    default:
+                        user_serial_transmit_character(0x00); //send 0/Error
+                        break;
+                }
+                break;
+
             case 0b0100: //configure peripherals w=power, x=pullups, y=AUX, z=CS
                 bp_binary_io_peripherals_set(inByte);
                 user_serial_transmit_character(1); //send 1/OK
@@ -1048,6 +2366,233 @@ void PIC416Write(unsigned char cmd, unsigned char datl, unsigned char dath) {
 
 }
 
+void raw_wire_long_bulk_transfer(const uint8_t command,
+                                 const bool three_wire) {
+  uint8_t *buffer;
+  uint16_t length;
+  uint16_t index;
+
+  length = user_serial_read_byte() << 8;
+  length |= user_serial_read_byte();
+  if ((length == 0) || (length > BP_TERMINAL_BUFFER_SIZE)) {
+    REPORT_IO_FAILURE();
+    return;
+  }
+
+  buffer = bus_pirate_configuration.terminal_input;
+
+  if (command == RAW_WIRE_LONG_BULK_READ) {
+    for (index = 0; index < length; index++) {
+      buffer[index] =
+          three_wire ? bitbang_read_with_write(0xFF) : bitbang_read_value();
+    }
+  } else {
+    for (index = 0; index < length; index++) {
+      buffer[index] = user_serial_read_byte();
+    }
+
+    if (mode_configuration.lsbEN == 1) {
+      for (index = 0; index < length; index++) {
+        buffer[index] = bp_reverse_byte(buffer[index]);
+      }
+    }
+
+    if (three_wire) {
+      for (index = 0; index < length; index++) {
+        buffer[index] = bitbang_read_with_write(buffer[index]);
+      }
+    } else {
+      for (index = 0; index < length; index++) {
+        bitbang_write_value(buffer[index]);
+      }
+    }
+  }
+
+  REPORT_IO_SUCCESS();
+
+  if ((command == RAW_WIRE_LONG_BULK_TRANSFER) && !three_wire) {
+    return;
+  }
+
+  if (mode_configuration.lsbEN == 1) {
+    for (index = 0; index < length; index++) {
+      buffer[index] = bp_reverse_byte(buffer[index]);
+    }
+  }
+
+  bp_write_buffer(buffer, length);
+}
+
+/* Row programming header fields. */
+#define PIC_ROW_GROUP_SIZE 0
+#define PIC_ROW_LOAD_COMMAND 1
+#define PIC_ROW_LAST_COMMAND 2
+#define PIC_ROW_GROUP_ENTRIES 3
+#define PIC_ROW_PROGRAM_ENTRIES 4
+#define PIC_ROW_NEXT_ENTRIES 5
+#define PIC_ROW_DELAY 6
+#define PIC_ROW_WORD_COUNT 7
+#define PIC_ROW_HEADER_SIZE 9
+
+/* PIC424 words are loaded in W0-W15, one register per word of a group. */
+#define PIC_ROW_PIC424_MAXIMUM_GROUP 16
+
+static void pic_row_run_entries(const uint8_t pic_mode, const uint8_t *entry,
+                                const uint8_t count,
+                                const uint8_t entry_size) {
+  uint8_t index;
+
+  for (index = 0; index < count; index++, entry += entry_size) {
+    switch (pic_mode) {
+    case PIC416:
+      PIC416Write(entry[0], entry[1], entry[2]);
+      break;
+
+    case PIC424:
+      PIC424Write((unsigned char *)entry, entry[3]);
+      break;
+
+    default:
+      PIC614Write(entry[0], entry[1], entry[2]);
+      break;
+    }
+  }
+}
+
+void raw_wire_pic_program_row(const uint8_t pic_mode) {
+  uint8_t header[PIC_ROW_HEADER_SIZE];
+  uint8_t *buffer;
+  uint8_t *data;
+  uint8_t entry_size;
+  uint8_t group;
+  uint16_t words;
+  uint16_t entries;
+  uint16_t length;
+  uint16_t index;
+
+  for (index = 0; index < PIC_ROW_HEADER_SIZE; index++) {
+    header[index] = user_serial_read_byte();
+  }
+
+  entry_size = (pic_mode == PIC424) ? 4 : 3;
+  entries = header[PIC_ROW_GROUP_ENTRIES] + header[PIC_ROW_PROGRAM_ENTRIES] +
+            header[PIC_ROW_NEXT_ENTRIES];
+  words = (header[PIC_ROW_WORD_COUNT] << 8) | header[PIC_ROW_WORD_COUNT + 1];
+  length = entries * entry_size;
+  if ((pic_mode != PIC416 && pic_mode != PIC424 && pic_mode != PIC614) ||
+      (header[PIC_ROW_GROUP_SIZE] == 0) ||
+      ((pic_mode == PIC424) &&
+       (header[PIC_ROW_GROUP_SIZE] > PIC_ROW_PIC424_MAXIMUM_GROUP)) ||
+      (words == 0) ||
+      (words > (BP_TERMINAL_BUFFER_SIZE - length) / 2)) {
+    REPORT_IO_FAILURE();
+    return;
+  }
+  length += words * 2;
+
+  buffer = bus_pirate_configuration.terminal_input;
+  for (index = 0; index < length; index++) {
+    buffer[index] = user_serial_read_byte();
+  }
+  data = &buffer[entries * entry_size];
+
+  group = 0;
+  for (index = 0; index < words; index++, data += 2) {
+    if (pic_mode == PIC424) {
+      /* MOV #word, Wgroup */
+      PIC424Write_internal(0x200000UL |
+                               ((unsigned long)((data[1] << 8) | data[0]) << 4) |
+                               group,
+                           0);
+    } else if (pic_mode == PIC416) {
+      PIC416Write((index == words - 1) ? header[PIC_ROW_LAST_COMMAND]
+                                       : header[PIC_ROW_LOAD_COMMAND],
+                  data[0], data[1]);
+    } else {
+      PIC614Write((index == words - 1) ? header[PIC_ROW_LAST_COMMAND]
+                                       : header[PIC_ROW_LOAD_COMMAND],
+                  data[0], data[1]);
+    }
+
+    if ((++group == header[PIC_ROW_GROUP_SIZE]) && (index < words - 1)) {
+      pic_row_run_entries(pic_mode, buffer, header[PIC_ROW_GROUP_ENTRIES],
+                          entry_size);
+      group = 0;
+    }
+  }
+
+  entries = header[PIC_ROW_GROUP_ENTRIES] * entry_size;
+  pic_row_run_entries(pic_mode, &buffer[entries],
+                      header[PIC_ROW_PROGRAM_ENTRIES], entry_size);
+  bp_delay_ms(header[PIC_ROW_DELAY]);
+  entries += header[PIC_ROW_PROGRAM_ENTRIES] * entry_size;
+  pic_row_run_entries(pic_mode, &buffer[entries], header[PIC_ROW_NEXT_ENTRIES],
+                      entry_size);
+
+  REPORT_IO_SUCCESS();
+}
+
+/* Time given to the executive to take PGD over, P8 is 12us. */
+#define PIC_PE_RELEASE_DELAY 20
+
+/* Time between PGD going low and the response being clocked, P9b is 15us. */
+#define PIC_PE_RESPONSE_DELAY 20
+
+/* How many 100us polls to wait for the executive, enough for a bulk erase. */
+#define PIC_PE_BUSY_POLLS 50000
+
+/* Words in the response header, the opcode/QE code word and the length. */
+#define PIC_PE_RESPONSE_HEADER 2
+
+void raw_wire_pic_pe_command(const uint8_t pic_mode) {
+  uint8_t *buffer;
+  uint16_t words;
+  uint16_t index;
+  uint16_t polls;
+
+  words = user_serial_read_byte() << 8;
+  words |= user_serial_read_byte();
+  if ((pic_mode != PIC424) || (words == 0) ||
+      (words > BP_TERMINAL_BUFFER_SIZE / 2)) {
+    REPORT_IO_FAILURE();
+    return;
+  }
+
+  buffer = bus_pirate_configuration.terminal_input;
+  for (index = 0; index < words * 2; index++) {
+    buffer[index] = user_serial_read_byte();
+  }
+  for (index = 0; index < words * 2; index++) {
+    bitbang_write_value(buffer[index]);
+  }
+
+  /* PGD goes back to the executive, high while busy and low when done. */
+  bitbang_read_pin(MOSI);
+  bp_delay_us(PIC_PE_RELEASE_DELAY);
+  for (polls = 0; bitbang_read_pin(MOSI); polls++) {
+    if (polls == PIC_PE_BUSY_POLLS) {
+      REPORT_IO_FAILURE();
+      return;
+    }
+    bp_delay_us(100);
+  }
+  bp_delay_us(PIC_PE_RESPONSE_DELAY);
+
+  REPORT_IO_SUCCESS();
+
+  for (index = 0; index < PIC_PE_RESPONSE_HEADER * 2; index++) {
+    buffer[index] = bitbang_read_value();
+    user_serial_transmit_character(buffer[index]);
+  }
+
+  /* The length counts every response word, the header included. */
+  words = (buffer[2] << 8) | buffer[3];
+  for (index = PIC_PE_RESPONSE_HEADER; index < words; index++) {
+    user_serial_transmit_character(bitbang_read_value());
+    user_serial_transmit_character(bitbang_read_value());
+  }
+}
+
 void PIC24NOP(void) {
     //send four bit SIX command (write)
     bitbang_write_bit(0); //send bit
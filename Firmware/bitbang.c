@@ -79,11 +79,241 @@ static uint16_t miso_pin;
  */
 static const bitbang_delays_t *delay_profile;
 
+#ifdef BP_BITBANG_SPECIALISED_KERNELS
+
+/**
+ * Value transfer loops for a given bus speed and pin output type.
+ */
+typedef struct {
+  /**
+   * @see bitbang_read_with_write
+   */
+  uint16_t (*read_with_write)(const uint16_t value);
+
+  /**
+   * @see bitbang_write_value
+   */
+  void (*write_value)(const uint16_t value);
+
+  /**
+   * @see bitbang_read_value
+   */
+  uint16_t (*read_value)(void);
+} bitbang_kernel_t;
+
+/**
+ * Sets the given pins HIGH in a transfer loop.
+ *
+ * @param[in] pins the bitmask of the pins to set.
+ * @param[in] high_impedance whether pins are in open collector mode, must be a
+ * compile time constant.
+ */
+#define KERNEL_SET_PINS_HIGH(pins, high_impedance)                             \
+  do {                                                                         \
+    if (high_impedance) {                                                      \
+      IODIR |= (pins);                                                         \
+    } else {                                                                   \
+      IOLAT |= (pins);                                                         \
+      IODIR &= ~(pins);                                                        \
+    }                                                                          \
+  } while (0)
+
+/**
+ * Sets the given pins LOW in a transfer loop.
+ *
+ * @param[in] pins the bitmask of the pins to set.
+ */
+#define KERNEL_SET_PINS_LOW(pins)                                              \
+  do {                                                                         \
+    IOLAT &= ~(pins);                                                          \
+    IODIR &= ~(pins);                                                          \
+  } while (0)
+
+/**
+ * Sets the given pins to the given state in a transfer loop.
+ *
+ * @param[in] state the state to set the pins to.
+ * @param[in] pins the bitmask of the pins to set.
+ * @param[in] high_impedance whether pins are in open collector mode, must be a
+ * compile time constant.
+ */
+#define KERNEL_SET_PINS(state, pins, high_impedance)                           \
+  do {                                                                         \
+    if (state) {                                                               \
+      KERNEL_SET_PINS_HIGH(pins, high_impedance);                              \
+    } else {                                                                   \
+      KERNEL_SET_PINS_LOW(pins);                                               \
+    }                                                                          \
+  } while (0)
+
+/**
+ * Waits for the given amount of microseconds in a transfer loop.
+ *
+ * @param[in] microseconds the time to wait, must be a compile time constant.
+ */
+#define KERNEL_DELAY(microseconds)                                             \
+  do {                                                                         \
+    if ((microseconds) > 0) {                                                  \
+      bp_delay_us(microseconds);                                               \
+    }                                                                          \
+  } while (0)
+
+/**
+ * Samples the given input pin in a transfer loop, shifting its state into the
+ * given variable.
+ *
+ * @param[in,out] target the variable to shift the pin state into.
+ * @param[in] pin the pin to read, which must already be set as an input.
+ */
+#define KERNEL_SAMPLE_PIN(target, pin)                                         \
+  do {                                                                         \
+    Nop();                                                                     \
+    Nop();                                                                     \
+    Nop();                                                                     \
+    target = (target << 1) | ((IOPOR & (pin)) != 0);                           \
+  } while (0)
+
+/**
+ * Generates the value transfer loops for a given bus speed and pin output
+ * type.
+ *
+ * The generated functions behave exactly like bitbang_read_with_write,
+ * bitbang_write_value, and bitbang_read_value, except for having the delay
+ * values and the output type baked in.  Each loop body is expanded twice: once
+ * for 8 bits values, with the bit count and masks known at build time, and
+ * once for any other value width.  Bit order is not a concern here, as LSB
+ * first values are already reversed by the callers.
+ *
+ * @param[in] suffix the suffix to append to the generated functions' names.
+ * @param[in] settle the settle delay in microseconds.
+ * @param[in] clock the clock delay in microseconds.
+ * @param[in] high_impedance whether pins are in open collector mode.
+ */
+#define BITBANG_KERNEL(suffix, settle, clock, high_impedance)                  \
+  static inline __attribute__((always_inline)) uint16_t                        \
+      read_with_write_bits_##suffix(const uint16_t value,                      \
+                                    const uint8_t bits) {                      \
+    uint16_t bit_index;                                                        \
+    uint16_t input;                                                            \
+                                                                               \
+    input = 0;                                                                 \
+    IODIR |= MISO;                                                             \
+    for (bit_index = 1 << (bits - 1); bit_index != 0; bit_index >>= 1) {       \
+      KERNEL_SET_PINS(value & bit_index, MOSI, high_impedance);                \
+      KERNEL_DELAY(settle);                                                    \
+      KERNEL_SET_PINS_HIGH(CLK, high_impedance);                               \
+      KERNEL_DELAY(clock);                                                     \
+      KERNEL_SAMPLE_PIN(input, MISO);                                          \
+      KERNEL_SET_PINS_LOW(CLK);                                                \
+      KERNEL_DELAY(clock);                                                     \
+    }                                                                          \
+                                                                               \
+    return input;                                                              \
+  }                                                                            \
+                                                                               \
+  static uint16_t read_with_write_##suffix(const uint16_t value) {             \
+    if (mode_configuration.numbits == 8) {                                     \
+      return read_with_write_bits_##suffix(value, 8);                          \
+    }                                                                          \
+    return read_with_write_bits_##suffix(value, mode_configuration.numbits);   \
+  }                                                                            \
+                                                                               \
+  static inline __attribute__((always_inline)) void write_value_bits_##suffix( \
+      const uint16_t value, const uint8_t bits) {                              \
+    uint16_t bit_index;                                                        \
+                                                                               \
+    for (bit_index = 1 << (bits - 1); bit_index != 0; bit_index >>= 1) {       \
+      KERNEL_SET_PINS(value & bit_index, MOSI, high_impedance);                \
+      KERNEL_DELAY(settle);                                                    \
+      KERNEL_SET_PINS_HIGH(CLK, high_impedance);                               \
+      KERNEL_DELAY(clock);                                                     \
+      KERNEL_SET_PINS_LOW(CLK);                                                \
+      KERNEL_DELAY(clock);                                                     \
+    }                                                                          \
+  }                                                                            \
+                                                                               \
+  static void write_value_##suffix(const uint16_t value) {                     \
+    if (mode_configuration.numbits == 8) {                                     \
+      write_value_bits_##suffix(value, 8);                                     \
+    } else {                                                                   \
+      write_value_bits_##suffix(value, mode_configuration.numbits);            \
+    }                                                                          \
+  }                                                                            \
+                                                                               \
+  static inline __attribute__((always_inline)) uint16_t                        \
+      read_value_bits_##suffix(const uint8_t bits) {                           \
+    uint16_t value;                                                            \
+    uint8_t count;                                                             \
+                                                                               \
+    /* Setup for input. */                                                     \
+    IODIR |= MOSI;                                                             \
+    value = 0;                                                                 \
+    for (count = 0; count < bits; count++) {                                   \
+      KERNEL_SET_PINS_HIGH(CLK, high_impedance);                               \
+      KERNEL_DELAY(clock);                                                     \
+      KERNEL_SAMPLE_PIN(value, MOSI);                                          \
+      KERNEL_SET_PINS_LOW(CLK);                                                \
+      KERNEL_DELAY(clock);                                                     \
+    }                                                                          \
+                                                                               \
+    return value;                                                              \
+  }                                                                            \
+                                                                               \
+  static uint16_t read_value_##suffix(void) {                                  \
+    if (mode_configuration.numbits == 8) {                                     \
+      return read_value_bits_##suffix(8);                                      \
+    }                                                                          \
+    return read_value_bits_##suffix(mode_configuration.numbits);               \
+  }
+
+/**
+ * Kernel table entry for the loops generated with the given suffix.
+ *
+ * @param[in] suffix the suffix used when invoking BITBANG_KERNEL.
+ */
+#define BITBANG_KERNEL_ENTRY(suffix)                                           \
+  {                                                                            \
+    .read_with_write = read_with_write_##suffix,                               \
+    .write_value = write_value_##suffix, .read_value = read_value_##suffix     \
+  }
+
+BITBANG_KERNEL(5khz, BB_5KHZSPEED_SETTLE, BB_5KHZSPEED_CLOCK, false)
+BITBANG_KERNEL(50khz, BB_50KHZSPEED_SETTLE, BB_50KHZSPEED_CLOCK, false)
+BITBANG_KERNEL(100khz, BB_100KHZSPEED_SETTLE, BB_100KHZSPEED_CLOCK, false)
+BITBANG_KERNEL(maximum, BB_MAXSPEED_SETTLE, BB_MAXSPEED_CLOCK, false)
+BITBANG_KERNEL(5khz_hiz, BB_5KHZSPEED_SETTLE, BB_5KHZSPEED_CLOCK, true)
+BITBANG_KERNEL(50khz_hiz, BB_50KHZSPEED_SETTLE, BB_50KHZSPEED_CLOCK, true)
+BITBANG_KERNEL(100khz_hiz, BB_100KHZSPEED_SETTLE, BB_100KHZSPEED_CLOCK, true)
+BITBANG_KERNEL(maximum_hiz, BB_MAXSPEED_SETTLE, BB_MAXSPEED_CLOCK, true)
+
+/**
+ * Transfer loops for every bus speed, first for normal output pins and then for
+ * open collector output pins.
+ *
+ * @see bp_bitbang_speed_t
+ */
+static const bitbang_kernel_t BITBANG_KERNELS[2][DELAY_PROFILES_MAX_INDEX + 1] =
+    {{BITBANG_KERNEL_ENTRY(5khz), BITBANG_KERNEL_ENTRY(50khz),
+      BITBANG_KERNEL_ENTRY(100khz), BITBANG_KERNEL_ENTRY(maximum)},
+     {BITBANG_KERNEL_ENTRY(5khz_hiz), BITBANG_KERNEL_ENTRY(50khz_hiz),
+      BITBANG_KERNEL_ENTRY(100khz_hiz), BITBANG_KERNEL_ENTRY(maximum_hiz)}};
+
+/**
+ * The transfer loops selected by the last bitbang_setup call.
+ */
+static const bitbang_kernel_t *kernel;
+
+#endif /* BP_BITBANG_SPECIALISED_KERNELS */
+
 void bitbang_setup(unsigned char bitbang_pins, const bp_bitbang_speed_t speed) {
+  uint8_t profile;
+
+  profile = speed > DELAY_PROFILES_MAX_INDEX ? DELAY_PROFILES_MAX_INDEX : speed;
   miso_pin = (bitbang_pins == 3) ? MISO : MOSI;
-  delay_profile = &BITBANG_DELAYS[speed > DELAY_PROFILES_MAX_INDEX
-                                      ? DELAY_PROFILES_MAX_INDEX
-                                      : speed];
+  delay_profile = &BITBANG_DELAYS[profile];
+#ifdef BP_BITBANG_SPECIALISED_KERNELS
+  kernel = &BITBANG_KERNELS[mode_configuration.high_impedance ? 1 : 0][profile];
+#endif /* BP_BITBANG_SPECIALISED_KERNELS */
 }
 
 bool bitbang_i2c_start(void) {
@@ -122,6 +352,18 @@ void bitbang_i2c_stop(void) {
   bitbang_set_pins_high(MOSI, delay_profile->clock);
 }
 
+#ifdef BP_BITBANG_SPECIALISED_KERNELS
+
+uint16_t bitbang_read_with_write(const uint16_t value) {
+  return kernel->read_with_write(value);
+}
+
+void bitbang_write_value(const uint16_t value) { kernel->write_value(value); }
+
+uint16_t bitbang_read_value(void) { return kernel->read_value(); }
+
+#else
+
 uint16_t bitbang_read_with_write(const uint16_t value) {
   size_t count;
   uint16_t temporary;
@@ -174,6 +416,8 @@ uint16_t bitbang_read_value(void) {
   return value;
 }
 
+#endif /* BP_BITBANG_SPECIALISED_KERNELS */
+
 bool bitbang_read_bit(void) {
   bool bit_value;
 
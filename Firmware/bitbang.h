@@ -56,6 +56,10 @@ typedef enum {
  * @param[in] pins the number of pins to use, 2 or 3.
  * @param[in] speed the bit-banging bus speed to use.
  *
+ * @warning The value transfer loops are picked here according to the given
+ * speed and to mode_configuration.high_impedance, so this must be called again
+ * whenever the pin output type changes.
+ *
  * @see BITBANG_SPEED_5KHZ
  * @see BITBANG_SPEED_50KHZ
  * @see BITBANG_SPEED_100KHZ
@@ -0,0 +1,396 @@
+/*
+ * This file is part of the Bus Pirate project
+ * (http://code.google.com/p/the-bus-pirate/).
+ *
+ * Written and maintained by the Bus Pirate project.
+ *
+ * To the extent possible under law, the project has
+ * waived all copyright and related or neighboring rights to Bus Pirate. This
+ * work is published from United States.
+ *
+ * For details see: http://creativecommons.org/publicdomain/zero/1.0/.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+#include "bus_timing.h"
+
+#ifdef BP_ENABLE_BUS_TIMING
+
+#include <stdint.h>
+#include <string.h>
+
+#include "base.h"
+#include "core.h"
+
+extern bus_pirate_configuration_t bus_pirate_configuration;
+extern bus_pirate_protocol_t enabled_protocols[ENABLED_PROTOCOLS_COUNT];
+
+/**
+ * Timed bus operations.
+ */
+typedef enum {
+  /** start and start_with_read. */
+  BUS_TIMING_START = 0,
+  /** send. */
+  BUS_TIMING_SEND,
+  /** read. */
+  BUS_TIMING_READ,
+  /** stop and stop_from_read. */
+  BUS_TIMING_STOP,
+  BUS_TIMING_OPERATIONS_COUNT
+} bus_timing_operation_t;
+
+/**
+ * Histogram buckets, bucket n counting calls taking 2^n to 2^(n+1)-1 cycles;
+ * the last one also counts the longer calls.
+ */
+#define BUS_TIMING_BUCKETS 16
+
+/**
+ * Timings of one kind of bus operation.
+ */
+typedef struct {
+  /** Calls made. */
+  uint32_t count;
+  /** Cycles spent in all calls. */
+  uint32_t total;
+  /** Shortest call, in cycles. */
+  uint32_t minimum;
+  /** Longest call, in cycles. */
+  uint32_t maximum;
+  /** Calls per duration bucket. */
+  uint32_t buckets[BUS_TIMING_BUCKETS];
+} bus_timing_statistics_t;
+
+/**
+ * Timings of one command line.
+ */
+typedef struct {
+  /** Per-operation timings. */
+  bus_timing_statistics_t operations[BUS_TIMING_OPERATIONS_COUNT];
+  /** Timer value when the line started. */
+  uint32_t started;
+  /** Cycles the whole line took. */
+  uint32_t elapsed;
+  /** Whether the timer kept running for the whole line. */
+  bool valid;
+} bus_timing_line_t;
+
+/**
+ * Bus timing state.
+ */
+typedef struct {
+  /** Line being timed, and the last line that ran bus operations. */
+  bus_timing_line_t lines[2];
+  /** Index of the line being timed. */
+  uint8_t current;
+  /** Whether lines[current ^ 1] holds a timed line. */
+  bool reported;
+  /** Whether the callbacks are swapped for the timing wrappers. */
+  bool active;
+  /** Mode the callbacks were swapped in. */
+  uint8_t bus_mode;
+  /** Cycles taken by reading the timer, taken out of every measurement. */
+  uint16_t overhead;
+  /** Original callbacks of the timed mode. */
+  void (*start)(void);
+  void (*start_with_read)(void);
+  void (*stop)(void);
+  void (*stop_from_read)(void);
+  uint16_t (*send)(uint16_t data);
+  uint16_t (*read)(void);
+} bus_timing_state_t;
+
+static bus_timing_state_t bus_timing_state;
+
+static const char *const BUS_TIMING_OPERATION_NAMES[BUS_TIMING_OPERATIONS_COUNT] = {
+    "start", "send", "read", "stop"};
+
+/**
+ * Reads Timer4/5 as a single 32 bit value, TMR5HLD holding the upper half
+ * latched when TMR4 is read.
+ */
+static inline uint32_t bus_timing_now(void) {
+  uint16_t low;
+
+  low = TMR4;
+  return ((uint32_t)TMR5HLD << 16) | low;
+}
+
+/**
+ * Accounts for one call of the given operation.
+ */
+static void bus_timing_record(const bus_timing_operation_t operation,
+                              const uint32_t started, const uint32_t ended) {
+  bus_timing_statistics_t *statistics;
+  uint32_t cycles;
+  uint8_t bucket;
+
+  statistics =
+      &bus_timing_state.lines[bus_timing_state.current].operations[operation];
+  cycles = ended - started;
+  cycles = (cycles > bus_timing_state.overhead)
+               ? cycles - bus_timing_state.overhead
+               : 0;
+
+  if ((statistics->count == 0) || (cycles < statistics->minimum)) {
+    statistics->minimum = cycles;
+  }
+  if (cycles > statistics->maximum) {
+    statistics->maximum = cycles;
+  }
+  statistics->count++;
+  statistics->total += cycles;
+
+  for (bucket = 0; (bucket < (BUS_TIMING_BUCKETS - 1)) && (cycles >> (bucket + 1));
+       bucket++) {
+  }
+  statistics->buckets[bucket]++;
+}
+
+static void bus_timing_start(void) {
+  uint32_t started;
+
+  started = bus_timing_now();
+  bus_timing_state.start();
+  bus_timing_record(BUS_TIMING_START, started, bus_timing_now());
+}
+
+static void bus_timing_start_with_read(void) {
+  uint32_t started;
+
+  started = bus_timing_now();
+  bus_timing_state.start_with_read();
+  bus_timing_record(BUS_TIMING_START, started, bus_timing_now());
+}
+
+static void bus_timing_stop(void) {
+  uint32_t started;
+
+  started = bus_timing_now();
+  bus_timing_state.stop();
+  bus_timing_record(BUS_TIMING_STOP, started, bus_timing_now());
+}
+
+static void bus_timing_stop_from_read(void) {
+  uint32_t started;
+
+  started = bus_timing_now();
+  bus_timing_state.stop_from_read();
+  bus_timing_record(BUS_TIMING_STOP, started, bus_timing_now());
+}
+
+static uint16_t bus_timing_send(uint16_t data) {
+  uint32_t started;
+  uint16_t result;
+
+  started = bus_timing_now();
+  result = bus_timing_state.send(data);
+  bus_timing_record(BUS_TIMING_SEND, started, bus_timing_now());
+
+  return result;
+}
+
+static uint16_t bus_timing_read(void) {
+  uint32_t started;
+  uint16_t result;
+
+  started = bus_timing_now();
+  result = bus_timing_state.read();
+  bus_timing_record(BUS_TIMING_READ, started, bus_timing_now());
+
+  return result;
+}
+
+void bp_bus_timing_begin(void) {
+  bus_pirate_protocol_t *protocol;
+  bus_timing_line_t *line;
+  uint32_t started;
+
+  line = &bus_timing_state.lines[bus_timing_state.current];
+  memset(line, 0, sizeof(bus_timing_line_t));
+
+  /*
+   * T4CON
+   *
+   * MSB
+   * 0-0------000-0-
+   * | |      ||| |
+   * | |      ||| +--- TCS:   Internal clock.
+   * | |      ||+----- T32:   TIMER4 is bound with TIMER5 for 32 bit mode.
+   * | |      ++------ TCKPS: 1:1 Prescaler.
+   * | +-------------- TSIDL: Continue module operation in idle mode.
+   * +---------------- TON:   Timer OFF.
+   */
+  T4CON = ON << _T4CON_T32_POSITION;
+  TMR5HLD = 0;
+  TMR4 = 0;
+  PR5 = 0xFFFF;
+  PR4 = 0xFFFF;
+  T4CONbits.TON = ON;
+
+  started = bus_timing_now();
+  bus_timing_state.overhead = bus_timing_now() - started;
+
+  protocol = &enabled_protocols[bus_pirate_configuration.bus_mode];
+  bus_timing_state.bus_mode = bus_pirate_configuration.bus_mode;
+  bus_timing_state.start = protocol->start;
+  bus_timing_state.start_with_read = protocol->start_with_read;
+  bus_timing_state.stop = protocol->stop;
+  bus_timing_state.stop_from_read = protocol->stop_from_read;
+  bus_timing_state.send = protocol->send;
+  bus_timing_state.read = protocol->read;
+  protocol->start = bus_timing_start;
+  protocol->start_with_read = bus_timing_start_with_read;
+  protocol->stop = bus_timing_stop;
+  protocol->stop_from_read = bus_timing_stop_from_read;
+  protocol->send = bus_timing_send;
+  protocol->read = bus_timing_read;
+  bus_timing_state.active = true;
+
+  line->started = bus_timing_now();
+}
+
+void bp_bus_timing_end(void) {
+  bus_pirate_protocol_t *protocol;
+  bus_timing_line_t *line;
+  bus_timing_operation_t operation;
+
+  if (!bus_timing_state.active) {
+    return;
+  }
+
+  line = &bus_timing_state.lines[bus_timing_state.current];
+  line->elapsed = bus_timing_now() - line->started;
+
+  /* Something else took the timer over, the values are meaningless. */
+  line->valid = (T4CONbits.TON == ON) && (T4CONbits.T32 == ON);
+  T4CON = 0x0000;
+
+  protocol = &enabled_protocols[bus_timing_state.bus_mode];
+  protocol->start = bus_timing_state.start;
+  protocol->start_with_read = bus_timing_state.start_with_read;
+  protocol->stop = bus_timing_state.stop;
+  protocol->stop_from_read = bus_timing_state.stop_from_read;
+  protocol->send = bus_timing_state.send;
+  protocol->read = bus_timing_state.read;
+  bus_timing_state.active = false;
+
+  /* Lines without bus operations, such as 't' itself, keep the last report. */
+  for (operation = BUS_TIMING_START; operation < BUS_TIMING_OPERATIONS_COUNT;
+       operation++) {
+    if (line->operations[operation].count != 0) {
+      bus_timing_state.current ^= 1;
+      bus_timing_state.reported = true;
+      return;
+    }
+  }
+}
+
+/**
+ * Prints a cycle count in microseconds, with one decimal.
+ */
+static void bus_timing_write_microseconds(const uint32_t cycles) {
+  uint32_t tenths;
+
+  tenths = (cycles * 10ULL) / (FCY / 1000000UL);
+  bp_write_dec_dword(tenths / 10);
+  user_serial_transmit_character('.');
+  bp_write_dec_byte(tenths % 10);
+  bp_write_string("us");
+}
+
+/**
+ * Prints a rate in bytes per second.
+ */
+static void bus_timing_write_rate(const uint32_t bytes, const uint32_t cycles) {
+  if (cycles == 0) {
+    bp_write_line("-");
+    return;
+  }
+
+  bp_write_dec_dword((uint32_t)(((uint64_t)bytes * FCY) / cycles));
+  bp_write_line(" bytes/s");
+}
+
+void bp_bus_timing_report(void) {
+  const bus_timing_line_t *line;
+  const bus_timing_statistics_t *statistics;
+  bus_timing_operation_t operation;
+  uint32_t bus_cycles;
+  uint32_t data_cycles;
+  uint32_t bytes;
+  uint8_t bucket;
+
+  if (!bus_timing_state.reported) {
+    bp_write_line("No timed bus operations yet");
+    return;
+  }
+
+  line = &bus_timing_state.lines[bus_timing_state.current ^ 1];
+  if (!line->valid) {
+    bp_write_line("Timer4/5 were used by the last line, no timings");
+    return;
+  }
+
+  bus_cycles = 0;
+  for (operation = BUS_TIMING_START; operation < BUS_TIMING_OPERATIONS_COUNT;
+       operation++) {
+    statistics = &line->operations[operation];
+    bus_cycles += statistics->total;
+    if (statistics->count == 0) {
+      continue;
+    }
+
+    bp_write_string(BUS_TIMING_OPERATION_NAMES[operation]);
+    bp_write_string(": ");
+    bp_write_dec_dword(statistics->count);
+    bp_write_string(" calls, min ");
+    bus_timing_write_microseconds(statistics->minimum);
+    bp_write_string(" avg ");
+    bus_timing_write_microseconds(statistics->total / statistics->count);
+    bp_write_string(" max ");
+    bus_timing_write_microseconds(statistics->maximum);
+    bpBR;
+
+    for (bucket = 0; bucket < BUS_TIMING_BUCKETS; bucket++) {
+      if (statistics->buckets[bucket] == 0) {
+        continue;
+      }
+      bp_write_string("  ");
+      bp_write_dec_dword(bucket ? (1UL << bucket) : 0);
+      if (bucket < (BUS_TIMING_BUCKETS - 1)) {
+        bp_write_string(" - ");
+        bp_write_dec_dword((1UL << (bucket + 1)) - 1);
+        bp_write_string(" cycles: ");
+      } else {
+        bp_write_string(" cycles and more: ");
+      }
+      bp_write_dec_dword(statistics->buckets[bucket]);
+      bpBR;
+    }
+  }
+
+  bytes = line->operations[BUS_TIMING_SEND].count +
+          line->operations[BUS_TIMING_READ].count;
+  data_cycles = line->operations[BUS_TIMING_SEND].total +
+                line->operations[BUS_TIMING_READ].total;
+
+  bp_write_string("Line: ");
+  bus_timing_write_microseconds(line->elapsed);
+  bp_write_string(", in bus operations: ");
+  bus_timing_write_microseconds(bus_cycles);
+  bp_write_string(", elsewhere: ");
+  bus_timing_write_microseconds(
+      (line->elapsed > bus_cycles) ? line->elapsed - bus_cycles : 0);
+  bpBR;
+  bp_write_string("Effective rate: ");
+  bus_timing_write_rate(bytes, line->elapsed);
+  bp_write_string("Rate within send/read: ");
+  bus_timing_write_rate(bytes, data_cycles);
+}
+
+#endif /* BP_ENABLE_BUS_TIMING */
@@ -0,0 +1,49 @@
+/*
+ * This file is part of the Bus Pirate project
+ * (http://code.google.com/p/the-bus-pirate/).
+ *
+ * Written and maintained by the Bus Pirate project.
+ *
+ * To the extent possible under law, the project has
+ * waived all copyright and related or neighboring rights to Bus Pirate. This
+ * work is published from United States.
+ *
+ * For details see: http://creativecommons.org/publicdomain/zero/1.0/.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+#ifndef BP_BUS_TIMING_H
+#define BP_BUS_TIMING_H
+
+#include "configuration.h"
+
+#ifdef BP_ENABLE_BUS_TIMING
+
+/**
+ * Starts timing the bus operations of the current mode for a new command line.
+ *
+ * The start, send, read and stop callbacks of the current mode are swapped
+ * for wrappers timestamping each call, so every caller is timed.
+ */
+void bp_bus_timing_begin(void);
+
+/**
+ * Stops timing and puts the original callbacks back.
+ *
+ * The timings are kept for bp_bus_timing_report if the line ran any bus
+ * operation.
+ */
+void bp_bus_timing_end(void);
+
+/**
+ * Prints per-operation latency histograms and throughput for the last command
+ * line that ran bus operations.
+ */
+void bp_bus_timing_report(void);
+
+#endif /* BP_ENABLE_BUS_TIMING */
+
+#endif /* !BP_BUS_TIMING_H */
@@ -252,9 +252,18 @@
  *
  * @note BPv3 default firmware status: INCLUDED
  * @note BPv4 default firmware status: INCLUDED
+ */
+
+/**
+ * #define BP_ENABLE_SWD_SUPPORT
  *
- * OpenOCD support is not yet available on v4 boards, however plans are
- * underway to get this working.
+ * Enables support for ARM Serial Wire Debug transfers via binary I/O commands,
+ * using the Bus Pirate as a debug probe for Cortex-M devices.
+ *
+ * @note BPv3 default firmware status: DISABLED
+ * @note BPv4 default firmware status: INCLUDED
+ *
+ * SWCLK is on the CLK pin, and SWDIO is on the MOSI pin.
  */
 
 /**
@@ -310,6 +319,7 @@
 #define BP_ENABLE_SMPS_SUPPORT
 #define BP_ENABLE_SPI_SUPPORT
 #define BP_ENABLE_SUMP_SUPPORT
+#define BP_ENABLE_SWD_SUPPORT
 #define BP_ENABLE_UART_SUPPORT
 #endif /* BUSPIRATEV4 */
 
@@ -327,6 +337,7 @@
 #undef BP_ENABLE_SMPS_SUPPORT
 #define BP_ENABLE_SPI_SUPPORT
 #define BP_ENABLE_SUMP_SUPPORT
+#undef BP_ENABLE_SWD_SUPPORT
 #define BP_ENABLE_UART_SUPPORT
 #endif /* BUSPIRATEV3 */
 
@@ -346,6 +357,7 @@
 #define BP_ENABLE_SMPS_SUPPORT
 #define BP_ENABLE_SPI_SUPPORT
 #define BP_ENABLE_SUMP_SUPPORT
+#define BP_ENABLE_SWD_SUPPORT
 #define BP_ENABLE_UART_SUPPORT
 #endif /* BP_CUSTOM_FEATURE_SET */
 
@@ -462,17 +474,14 @@
 
 #ifdef BP_ENABLE_JTAG_SUPPORT
 
-#ifdef BUSPIRATEV3
-
 /**
  * Allow OpenOCD to interact with the Bus Pirate board for JTAG operations.
  *
- * This is not yet supported on v4 boards.
+ * On v4 boards TAP shift data moves straight through the USB CDC buffers
+ * rather than through the UART interrupt handlers used on v3 boards.
  */
 #define BP_JTAG_OPENOCD_SUPPORT
 
-#endif /* BUSPIRATEV3 */
-
 #ifdef BUSPIRATEV4
 
 /**
@@ -484,10 +493,72 @@
  */
 #define BP_JTAG_XSVF_SUPPORT
 
+/**
+ * Enable chain enumeration and boundary-scan sampling in binary JTAG mode.
+ *
+ * Binary JTAG mode is only reachable on v4 boards.
+ */
+#define BP_JTAG_BOUNDARY_SCAN_SUPPORT
+
 #endif /* BUSPIRATEV4 */
 
 #endif /* BP_ENABLE_JTAG_SUPPORT */
 
+/* Bit-banging module configuration definitions. */
+
+#ifdef BUSPIRATEV4
+
+/**
+ * Use transfer loops specialised at compile time for every bus speed and pin
+ * output type when bit-banging values on the bus.
+ *
+ * Each bus speed and output type combination gets its own copy of the value
+ * transfer loops, with pin access and delays resolved when building the
+ * firmware rather than at every bit, plus a further copy for 8 bits values
+ * with a fixed bit count.  This removes the per-bit delay lookups of raw
+ * 2-wire and 3-wire modes at the cost of some extra flash space.
+ *
+ * This is not enabled on v3 boards due to taking up too much memory.
+ */
+#define BP_BITBANG_SPECIALISED_KERNELS
+
+#endif /* BUSPIRATEV4 */
+
+/* Binary I/O module configuration definitions. */
+
+#ifdef BUSPIRATEV4
+
+/*
+ * These binary bitbang mode commands are not enabled on v3 boards due to
+ * taking up too much memory.
+ */
+
+/**
+ * Enable the timer paced ADC stream, the triggered oscilloscope frames, and
+ * the voltage telemetry stream.
+ */
+#define BP_ENABLE_ADC_STREAMS
+
+/**
+ * Enable the background frequency, period and duty cycle measurements on the
+ * AUX pin, and their stream.
+ */
+#define BP_ENABLE_FREQUENCY_STREAM
+
+/**
+ * Enable the pattern generator, the pin sequencer, and the bulk pin states
+ * command.
+ */
+#define BP_ENABLE_PIN_SEQUENCES
+
+/**
+ * Enable the Timer1 driven software PWM on the AUX, MOSI, CLK, MISO and CS
+ * pins.
+ */
+#define BP_ENABLE_SOFTWARE_PWM
+
+#endif /* BUSPIRATEV4 */
+
 /* Module-agnostic configuration definitions. */
 
 /**
@@ -508,6 +579,16 @@
 
 #endif /* BP_ENABLE_COMMAND_HISTORY */
 
+/**
+ * Enable timing of the bus operations run by terminal command lines, and the
+ * 't' command reporting it for the last line that ran any.
+ *
+ * Every start, send, read and stop callback is timestamped with Timer4/5 as a
+ * free running 32 bit counter, so commands using those timers ('f') cannot be
+ * timed.  Left out by default, it costs some cycles per bus operation.
+ */
+#undef BP_ENABLE_BUS_TIMING
+
 /**
  * How many user-defined macros can be set.
  */
@@ -537,6 +618,33 @@
 #define BP_COMMAND_BUFFER_SIZE 256
 #endif /* BUSPIRATEV3 */
 
+#ifdef BUSPIRATEV3
+
+/**
+ * How big the terminal output queue drained by the UART1 transmission
+ * interrupt can be, in bytes.
+ *
+ * @warning This must be set to a power of two, 256 at most.
+ */
+#define BP_USER_SERIAL_OUTPUT_BUFFER_SIZE 128
+
+#endif /* BUSPIRATEV3 */
+
+#ifdef BUSPIRATEV4
+
+/**
+ * Compile command lines made of bus commands only, and run them from their
+ * compiled form.  Running the same line again reuses the compiled form.
+ */
+#define BP_ENABLE_COMMAND_COMPILER
+
+/**
+ * How many bus commands a compiled command line can hold.
+ */
+#define BP_COMPILED_COMMAND_MAX_OPERATIONS 64
+
+#endif /* BUSPIRATEV4 */
+
 /**
  * How big the serial terminal buffer can be, in bytes.
  *
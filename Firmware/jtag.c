@@ -23,6 +23,8 @@
 #include <stdbool.h>
 
 #include "base.h"
+#include "binary_io.h"
+#include "core.h"
 
 #include "jtag/micro.h"
 #include "jtag/ports.h"
@@ -56,6 +58,26 @@ void jtagDataHigh(void);
 void jtagClockLow(void);
 void jtagClockHigh(void);
 void jtagClockTicks(unsigned char c);
+
+#ifdef BP_JTAG_BOUNDARY_SCAN_SUPPORT
+
+extern bus_pirate_configuration_t bus_pirate_configuration;
+
+/* Longest IR chain explored when enumerating devices, in bits. */
+#define JTAG_CHAIN_MAX_BITS 1024
+
+/* Most devices reported by a chain enumeration. */
+#define JTAG_CHAIN_MAX_DEVICES 32
+
+/* The ones shifted in after the last IDCODE, never a valid IDCODE. */
+#define JTAG_IDCODE_END 0xFFFFFFFFUL
+
+static unsigned char jtagFastShift(unsigned char tdi, unsigned char tms, unsigned char bits);
+static void jtagFastShiftFill(unsigned char tdi, unsigned int bits, bool exit);
+static void jtagEnumerateChain(void);
+static void jtagSampleBoundary(void);
+
+#endif /* BP_JTAG_BOUNDARY_SCAN_SUPPORT */
 void jtagTMSHigh(void);
 void jtagTMSLow(void);
 
@@ -147,9 +169,18 @@ void jtag(void){
                         /* Insert new errors here */
                         #define XSVF_ERROR_LAST         7
                         i=xsvfExecute();
+                        xsvf_finish();
                         user_serial_transmit_character(i);
                         break;
 #endif /* BP_JTAG_XSVF_SUPPORT */
+#ifdef BP_JTAG_BOUNDARY_SCAN_SUPPORT
+                case 4://enumerate chain: IR length, device count, IDCODEs
+                        jtagEnumerateChain();
+                        break;
+                case 5://SAMPLE/PRELOAD boundary scan stream
+                        jtagSampleBoundary();
+                        break;
+#endif /* BP_JTAG_BOUNDARY_SCAN_SUPPORT */
                 default:
                         break;//bpWmessage(MSG_ERROR_MACRO);
         }//switch
@@ -404,4 +435,200 @@ void jtagTMSLow(void){
         bp_delay_us(JTAGDATASETTLE);//delay
 }
 
+#ifdef BP_JTAG_BOUNDARY_SCAN_SUPPORT
+
+/*
+ * Shifts up to 8 TDI/TMS bit pairs out, LSB first, at full speed and returns
+ * the TDO bits sampled on each rising TCK edge, right-aligned. TCK is left
+ * low, as the other jtag* routines expect.
+ */
+static unsigned char jtagFastShift(unsigned char tdi, unsigned char tms, unsigned char bits) {
+        unsigned char tdo, bit;
+        unsigned int latch;
+
+        tdo = 0;
+        for (bit = 0; bit < bits; bit++) {
+                latch = IOLAT & ~(MOSI | CS | CLK);
+                if (tdi & 1) {
+                        latch |= MOSI;
+                }
+                if (tms & 1) {
+                        latch |= CS;
+                }
+                IOLAT = latch;
+                tdi >>= 1;
+                tms >>= 1;
+
+                IOLAT |= CLK;
+                tdo >>= 1;
+                if (IOPOR & MISO) {
+                        tdo |= 0x80;
+                }
+        }
+        IOLAT &= ~CLK;
+
+        return tdo >> (8 - bits);
+}
+
+//shifts the same TDI level for the given bits, raising TMS on the last one if exit
+static void jtagFastShiftFill(unsigned char tdi, unsigned int bits, bool exit) {
+        unsigned char count;
+
+        tdi = tdi ? 0xFF : 0x00;
+        while (bits > 0) {
+                count = (bits > 8) ? 8 : bits;
+                bits -= count;
+                jtagFastShift(tdi, (exit && bits == 0) ? (1 << (count - 1)) : 0, count);
+        }
+}
+
+/*
+ * Finds out how the chain is made up, from Test-Logic-Reset:
+ *
+ * 1. every device loads IDCODE, or BYPASS when it has none, in its DR: the DR
+ *    chain is read with ones shifted in, an IDCODE starts with a 1 and takes
+ *    32 bits, a BYPASS register is a single 0, and reading 32 ones means the
+ *    end of the chain has been reached;
+ * 2. the IR chain is filled with ones and then shifted with zeros, the number
+ *    of ones coming out is the total IR length;
+ * 3. the IR chain is filled with ones, selecting BYPASS everywhere, and the DR
+ *    chain is flushed with zeros: the number of zeros coming out before the
+ *    first one is the number of devices.
+ *
+ * Replies 0x01 when both device counts agree and the IR length is sane, 0x00
+ * otherwise, then the device count, the IR length (MSB first) and the IDCODE
+ * of each device read (LSB first, 0 for devices without IDCODE).
+ */
+static void jtagEnumerateChain(void) {
+        uint8_t *buffer = bus_pirate_configuration.terminal_input;
+        unsigned char ids, devices, byte;
+        unsigned int ir_length;
+        uint32_t idcode;
+
+        jtagFastShift(0x00, 0x1F, 5); //Test-Logic-Reset
+        jtagFastShift(0x00, 0x02, 4); //Run-Test/Idle, Select-DR, Capture-DR, Shift-DR
+
+        for (ids = 0; ids < JTAG_CHAIN_MAX_DEVICES; ids++) {
+                idcode = 0;
+                if (jtagFastShift(0x01, 0x00, 1)) {
+                        idcode = 1;
+                        for (byte = 0; byte < 4; byte++) {
+                                idcode |= (uint32_t)jtagFastShift(0xFF, 0x00, (byte == 3) ? 7 : 8) << (1 + (byte * 8));
+                        }
+                        if (idcode == JTAG_IDCODE_END) {
+                                break;
+                        }
+                }
+                buffer[ids * 4] = idcode;
+                buffer[(ids * 4) + 1] = idcode >> 8;
+                buffer[(ids * 4) + 2] = idcode >> 16;
+                buffer[(ids * 4) + 3] = idcode >> 24;
+        }
+        jtagFastShift(0x01, 0x01, 1); //Exit1-DR
+        jtagFastShift(0x00, 0x01, 2); //Update-DR, Run-Test/Idle
+
+        jtagFastShift(0x00, 0x03, 4); //Select-DR, Select-IR, Capture-IR, Shift-IR
+        jtagFastShiftFill(1, JTAG_CHAIN_MAX_BITS, false);
+        for (ir_length = 0; ir_length < JTAG_CHAIN_MAX_BITS; ir_length++) {
+                if (!jtagFastShift(0x00, 0x00, 1)) {
+                        break;
+                }
+        }
+        jtagFastShiftFill(1, JTAG_CHAIN_MAX_BITS, true); //BYPASS everywhere
+        jtagFastShift(0x00, 0x01, 2); //Update-IR, Run-Test/Idle
+
+        jtagFastShift(0x00, 0x01, 3); //Select-DR, Capture-DR, Shift-DR
+        jtagFastShiftFill(0, JTAG_CHAIN_MAX_DEVICES + 1, false);
+        for (devices = 0; devices <= JTAG_CHAIN_MAX_DEVICES; devices++) {
+                if (jtagFastShift(0x01, 0x00, 1)) {
+                        break;
+                }
+        }
+        jtagFastShift(0x01, 0x01, 1); //Exit1-DR
+        jtagFastShift(0x00, 0x01, 2); //Update-DR, Run-Test/Idle
+        jtag_settings.state = IDLE;
+        jtag_settings.bit_pending = false;
+
+        if ((devices == ids) && (ir_length < JTAG_CHAIN_MAX_BITS) && (ir_length >= devices)) {
+                REPORT_IO_SUCCESS();
+        } else {
+                REPORT_IO_FAILURE();
+        }
+        if (devices > ids) {
+                devices = ids;
+        }
+        user_serial_transmit_character(devices);
+        user_serial_transmit_character(ir_length >> 8);
+        user_serial_transmit_character(ir_length);
+        bp_write_buffer(buffer, devices * 4);
+}
+
+/*
+ * Loads an instruction, normally SAMPLE/PRELOAD, in the IR chain and then
+ * captures the DR chain over and over at full TCK speed, streaming every
+ * vector captured to the host. Ones are shifted in the DR chain, which is
+ * harmless for SAMPLE/PRELOAD.
+ *
+ * PC sends the IR length in bits (MSB first, 1 to JTAG_CHAIN_MAX_BITS), and
+ * the Bus Pirate answers 0x00 straight away if it is invalid. Otherwise PC
+ * sends the IR value for the whole chain (LSB first), the DR length in bits
+ * (MSB first, not 0) and the number of vectors to capture (MSB first, 0 to
+ * run until PC sends any byte). The Bus Pirate answers 0x00 if the DR length
+ * is 0, or 0x01 followed by the vectors, each one LSB first and padded to a
+ * whole number of bytes.
+ */
+static void jtagSampleBoundary(void) {
+        uint8_t *buffer = bus_pirate_configuration.terminal_input;
+        unsigned int ir_length, dr_length, vectors, bits, byte;
+        unsigned char count;
+
+        ir_length = user_serial_read_byte() << 8;
+        ir_length |= user_serial_read_byte();
+        if ((ir_length == 0) || (ir_length > JTAG_CHAIN_MAX_BITS)) {
+                REPORT_IO_FAILURE();
+                return;
+        }
+        for (byte = 0; byte < (ir_length + 7) / 8; byte++) {
+                buffer[byte] = user_serial_read_byte();
+        }
+        dr_length = user_serial_read_byte() << 8;
+        dr_length |= user_serial_read_byte();
+        vectors = user_serial_read_byte() << 8;
+        vectors |= user_serial_read_byte();
+        if (dr_length == 0) {
+                REPORT_IO_FAILURE();
+                return;
+        }
+        REPORT_IO_SUCCESS();
+
+        jtagFastShift(0x00, 0x1F, 5); //Test-Logic-Reset
+        jtagFastShift(0x00, 0x06, 5); //Run-Test/Idle, Select-DR, Select-IR, Capture-IR, Shift-IR
+        for (byte = 0, bits = ir_length; bits > 0; byte++) {
+                count = (bits > 8) ? 8 : bits;
+                bits -= count;
+                jtagFastShift(buffer[byte], (bits == 0) ? (1 << (count - 1)) : 0, count);
+        }
+        jtagFastShift(0x00, 0x01, 2); //Update-IR, Run-Test/Idle
+
+        do {
+                if ((vectors == 0) && user_serial_ready_to_read()) {
+                        user_serial_read_byte();
+                        break;
+                }
+
+                jtagFastShift(0x00, 0x01, 3); //Select-DR, Capture-DR, Shift-DR
+                for (bits = dr_length; bits > 0; ) {
+                        count = (bits > 8) ? 8 : bits;
+                        bits -= count;
+                        user_serial_transmit_character(jtagFastShift(0xFF, (bits == 0) ? (1 << (count - 1)) : 0, count));
+                }
+                jtagFastShift(0x00, 0x01, 2); //Update-DR, Run-Test/Idle
+        } while ((vectors == 0) || (--vectors > 0));
+
+        jtag_settings.state = IDLE;
+        jtag_settings.bit_pending = false;
+}
+
+#endif /* BP_JTAG_BOUNDARY_SCAN_SUPPORT */
+
 #endif /* BP_ENABLE_JTAG_SUPPORT */
@@ -13,18 +13,97 @@
 
 #include "ports.h"
 #include "../jtag.h"
-#define MAX_BUFFER 4096
-static unsigned char buf[MAX_BUFFER]; //buffer to hold incoming bytes
+#define MAX_BUFFER 4096 //must be a power of two
+//ask the host for the next chunk once at most half of the buffer is left
+#define PREFETCH_THRESHOLD (MAX_BUFFER/2)
+#define XSVF_READY_FOR_DATA 0xFF
+#define XSVF_COMPLETE 0x00 //XCOMPLETE command, ends the XSVF stream
+
+//where we are in receiving the chunk the host was asked for
+enum {
+        STREAM_IDLE=0, //no chunk requested
+        STREAM_LENGTH_HIGH, //waiting for the chunk length MSB
+        STREAM_LENGTH_LOW, //waiting for the chunk length LSB
+        STREAM_DATA, //receiving chunk data
+        STREAM_END, //host sent a zero length chunk, no more data
+};
+
+//ring buffer holding incoming bytes, split in two halves: the next chunk is
+//requested as soon as the first half is consumed, so the host sends more data
+//while the bytes in the second half are played
+static unsigned char buf[MAX_BUFFER];
 static unsigned int bufBytes=0, bufPointer=0;
+static unsigned int chunkBytes=0;
+static unsigned char streamState=STREAM_IDLE;
+
+//moves whatever the host already sent into the ring buffer, without waiting
+static void receiveBytes(void){
+        unsigned char c;
+
+        if((streamState==STREAM_IDLE) && (bufBytes<=PREFETCH_THRESHOLD)){
+                user_serial_transmit_character(XSVF_READY_FOR_DATA);
+                streamState=STREAM_LENGTH_HIGH;
+        }
+
+        //bytes not taken in yet wait in the USB buffers, the host is held off
+        while((streamState!=STREAM_IDLE) && (streamState!=STREAM_END) &&
+              (bufBytes<MAX_BUFFER) && user_serial_ready_to_read()){
+                c=user_serial_read_byte();
+                switch(streamState){
+                        case STREAM_LENGTH_HIGH:
+                                chunkBytes=c<<8;
+                                streamState=STREAM_LENGTH_LOW;
+                                break;
+                        case STREAM_LENGTH_LOW:
+                                chunkBytes|=c;
+                                streamState=(chunkBytes==0)?STREAM_END:STREAM_DATA;
+                                break;
+                        default: //STREAM_DATA
+                                buf[(bufPointer+bufBytes)&(MAX_BUFFER-1)]=c;
+                                bufBytes++;
+                                chunkBytes--;
+                                if(chunkBytes==0) streamState=STREAM_IDLE;
+                                break;
+                }
+        }
+}
 
 void xsvf_setup(void){
         bufBytes=0;
+        bufPointer=0;
+        chunkBytes=0;
+        streamState=STREAM_IDLE;
         JTAGTDI_TRIS=0;
         JTAGTCK_TRIS=0;
         JTAGTD0_TRIS=1;
         JTAGTMS_TRIS=0;
 }
 
+//the player may stop on an error while a chunk is still on its way: read the
+//rest of it so jtag() does not take leftover XSVF bytes for commands
+void xsvf_finish(void){
+        unsigned char c;
+
+        while((streamState==STREAM_LENGTH_HIGH) || (streamState==STREAM_LENGTH_LOW) ||
+              (streamState==STREAM_DATA)){
+                c=user_serial_read_byte();
+                switch(streamState){
+                        case STREAM_LENGTH_HIGH:
+                                chunkBytes=c<<8;
+                                streamState=STREAM_LENGTH_LOW;
+                                break;
+                        case STREAM_LENGTH_LOW:
+                                chunkBytes|=c;
+                                streamState=(chunkBytes==0)?STREAM_END:STREAM_DATA;
+                                break;
+                        default: //STREAM_DATA, the bytes are thrown away
+                                chunkBytes--;
+                                if(chunkBytes==0) streamState=STREAM_IDLE;
+                                break;
+                }
+        }
+}
+
 void setPort(short p,short val){
     if (p==TMS) {JTAGTMS = (unsigned char) val;}//  bpDelayUS(10);}
     if (p==TDI) {JTAGTDI = (unsigned char) val;}//  bpDelayUS(10);}
@@ -32,24 +111,17 @@ void setPort(short p,short val){
 }
 
 void readByte(unsigned char *data){
-        unsigned int i;
-        unsigned char bh, bl;
-
-        if(bufBytes==0){
-                user_serial_transmit_character(0xff);
-       //--- while(U1STAbits.URXDA == 0);  //--- dont use it as already in UART1RX => dead lock
-                bh=user_serial_read_byte();//get up to 255 bytes each time
-                bl=user_serial_read_byte();//get up to 255 bytes each time
-                bufBytes=(bh<<8)|bl;
-                for(i=0; i<bufBytes; i++){
-           //---     while(U1STAbits.URXDA == 0); //--- dont use it otherwise dead lock
-                        buf[i]=user_serial_read_byte();
+        receiveBytes();
+        while(bufBytes==0){ //ran dry, wait for the host
+                if(streamState==STREAM_END){ //out of data, end the stream cleanly
+                        (*data)=XSVF_COMPLETE;
+                        return;
                 }
-                bufPointer=0;
+                receiveBytes();
         }
 
         (*data)=buf[bufPointer];
-        bufPointer++;
+        bufPointer=(bufPointer+1)&(MAX_BUFFER-1);
         bufBytes--;
 }
 
@@ -13,6 +13,9 @@
 //setup the read buffer before starting
 void xsvf_setup(void);
 
+//drain what is left of the chunk requested from the host, before the result
+void xsvf_finish(void);
+
 //setup the specified output pin p with val
 extern void setPort(short p, short val);
 
@@ -82,6 +82,9 @@ void print_help(void) {
   HLP1020;
   HLP1021;
   HLP1022;
+#ifdef BP_ENABLE_BUS_TIMING
+  HLP1023;
+#endif /* BP_ENABLE_BUS_TIMING */
 }
 
 bool agree(void) {
@@ -353,6 +353,8 @@ void HLP1021_str(void);
 #define HLP1021 bp_message_write_line(__builtin_tbladdress(HLP1021_str))
 void HLP1022_str(void);
 #define HLP1022 bp_message_write_line(__builtin_tbladdress(HLP1022_str))
+void HLP1023_str(void);
+#define HLP1023 bp_message_write_line(__builtin_tbladdress(HLP1023_str))
 void MSG_1WIRE_ADDRESS_MACRO_HEADER_str(void);
 #define MSG_1WIRE_ADDRESS_MACRO_HEADER bp_message_write_buffer(__builtin_tbladdress(MSG_1WIRE_ADDRESS_MACRO_HEADER_str))
 void MSG_1WIRE_ALARM_MACRO_NAME_str(void);
@@ -379,6 +381,10 @@ void MSG_1WIRE_NO_DEVICE_str(void);
 #define MSG_1WIRE_NO_DEVICE bp_message_write_line(__builtin_tbladdress(MSG_1WIRE_NO_DEVICE_str))
 void MSG_1WIRE_NO_DEVICE_DETECTED_str(void);
 #define MSG_1WIRE_NO_DEVICE_DETECTED bp_message_write_buffer(__builtin_tbladdress(MSG_1WIRE_NO_DEVICE_DETECTED_str))
+void MSG_1WIRE_OVERDRIVE_MATCH_ROM_MACRO_NAME_str(void);
+#define MSG_1WIRE_OVERDRIVE_MATCH_ROM_MACRO_NAME bp_message_write_line(__builtin_tbladdress(MSG_1WIRE_OVERDRIVE_MATCH_ROM_MACRO_NAME_str))
+void MSG_1WIRE_OVERDRIVE_SKIP_ROM_MACRO_NAME_str(void);
+#define MSG_1WIRE_OVERDRIVE_SKIP_ROM_MACRO_NAME bp_message_write_line(__builtin_tbladdress(MSG_1WIRE_OVERDRIVE_SKIP_ROM_MACRO_NAME_str))
 void MSG_1WIRE_PINS_STATE_str(void);
 #define MSG_1WIRE_PINS_STATE bp_message_write_line(__builtin_tbladdress(MSG_1WIRE_PINS_STATE_str))
 void MSG_1WIRE_READ_ROM_MACRO_NAME_str(void);
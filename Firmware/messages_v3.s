@@ -1054,6 +1054,12 @@ _HLP1021_str:
 _HLP1022_str:
 	.pasciz " w/W\tPSU (off/ON)\t\t<x>/<x= >/<0>\tUsermacro x/assign x/list all"
 
+	; HLP1023
+	.section .text.HLP1023, code
+	.global _HLP1023_str
+_HLP1023_str:
+	.pasciz " t\tBus operation timings (last line)"
+
 	; MSG_1WIRE_ADDRESS_MACRO_HEADER
 	.section .text.MSG_1WIRE_ADDRESS_MACRO_HEADER, code
 	.global _MSG_1WIRE_ADDRESS_MACRO_HEADER_str
@@ -1082,7 +1088,7 @@ _MSG_1WIRE_LOOKUP_ID_HEADER_str:
 	.section .text.MSG_1WIRE_MACRO_LIST, code
 	.global _MSG_1WIRE_MACRO_LIST_str
 _MSG_1WIRE_MACRO_LIST_str:
-	.pasciz "1WIRE ROM COMMAND MACROs:\r\n 51.READ ROM (0x33) *for single device bus\r\n 85.MATCH ROM (0x55) *followed by 64bit address\r\n 204.SKIP ROM (0xCC) *followed by command\r\n 236.ALARM SEARCH (0xEC)\r\n 240.SEARCH ROM (0xF0)"
+	.pasciz "1WIRE ROM COMMAND MACROs:\r\n 51.READ ROM (0x33) *for single device bus\r\n 60.OVERDRIVE SKIP ROM (0x3C) *switches bus to overdrive\r\n 85.MATCH ROM (0x55) *followed by 64bit address\r\n 105.OVERDRIVE MATCH ROM (0x69) *followed by 64bit address\r\n 204.SKIP ROM (0xCC) *followed by command\r\n 236.ALARM SEARCH (0xEC)\r\n 240.SEARCH ROM (0xF0)"
 
 	; MSG_1WIRE_MACRO_MENU_HEADER
 	.section .text.MSG_1WIRE_MACRO_MENU_HEADER, code
@@ -1132,6 +1138,18 @@ _MSG_1WIRE_NO_DEVICE_str:
 _MSG_1WIRE_NO_DEVICE_DETECTED_str:
 	.pasciz "*No device detected "
 
+	; MSG_1WIRE_OVERDRIVE_MATCH_ROM_MACRO_NAME
+	.section .text.MSG_1WIRE_OVERDRIVE_MATCH_ROM_MACRO_NAME, code
+	.global _MSG_1WIRE_OVERDRIVE_MATCH_ROM_MACRO_NAME_str
+_MSG_1WIRE_OVERDRIVE_MATCH_ROM_MACRO_NAME_str:
+	.pasciz "OVERDRIVE MATCH ROM (0x69)"
+
+	; MSG_1WIRE_OVERDRIVE_SKIP_ROM_MACRO_NAME
+	.section .text.MSG_1WIRE_OVERDRIVE_SKIP_ROM_MACRO_NAME, code
+	.global _MSG_1WIRE_OVERDRIVE_SKIP_ROM_MACRO_NAME_str
+_MSG_1WIRE_OVERDRIVE_SKIP_ROM_MACRO_NAME_str:
+	.pasciz "OVERDRIVE SKIP ROM (0x3C)"
+
 	; MSG_1WIRE_PINS_STATE
 	.section .text.MSG_1WIRE_PINS_STATE, code
 	.global _MSG_1WIRE_PINS_STATE_str
@@ -385,6 +385,8 @@ void HLP1021_str(void);
 #define HLP1021 bp_message_write_line(__builtin_tbladdress(HLP1021_str))
 void HLP1022_str(void);
 #define HLP1022 bp_message_write_line(__builtin_tbladdress(HLP1022_str))
+void HLP1023_str(void);
+#define HLP1023 bp_message_write_line(__builtin_tbladdress(HLP1023_str))
 void MSG_1WIRE_ADDRESS_MACRO_HEADER_str(void);
 #define MSG_1WIRE_ADDRESS_MACRO_HEADER bp_message_write_buffer(__builtin_tbladdress(MSG_1WIRE_ADDRESS_MACRO_HEADER_str))
 void MSG_1WIRE_ALARM_MACRO_NAME_str(void);
@@ -411,6 +413,10 @@ void MSG_1WIRE_NO_DEVICE_str(void);
 #define MSG_1WIRE_NO_DEVICE bp_message_write_line(__builtin_tbladdress(MSG_1WIRE_NO_DEVICE_str))
 void MSG_1WIRE_NO_DEVICE_DETECTED_str(void);
 #define MSG_1WIRE_NO_DEVICE_DETECTED bp_message_write_buffer(__builtin_tbladdress(MSG_1WIRE_NO_DEVICE_DETECTED_str))
+void MSG_1WIRE_OVERDRIVE_MATCH_ROM_MACRO_NAME_str(void);
+#define MSG_1WIRE_OVERDRIVE_MATCH_ROM_MACRO_NAME bp_message_write_line(__builtin_tbladdress(MSG_1WIRE_OVERDRIVE_MATCH_ROM_MACRO_NAME_str))
+void MSG_1WIRE_OVERDRIVE_SKIP_ROM_MACRO_NAME_str(void);
+#define MSG_1WIRE_OVERDRIVE_SKIP_ROM_MACRO_NAME bp_message_write_line(__builtin_tbladdress(MSG_1WIRE_OVERDRIVE_SKIP_ROM_MACRO_NAME_str))
 void MSG_1WIRE_PINS_STATE_str(void);
 #define MSG_1WIRE_PINS_STATE bp_message_write_line(__builtin_tbladdress(MSG_1WIRE_PINS_STATE_str))
 void MSG_1WIRE_READ_ROM_MACRO_NAME_str(void);
@@ -491,6 +497,8 @@ void MSG_NO_VOLTAGE_ON_PULLUP_PIN_str(void);
 #define MSG_NO_VOLTAGE_ON_PULLUP_PIN bp_message_write_line(__builtin_tbladdress(MSG_NO_VOLTAGE_ON_PULLUP_PIN_str))
 void MSG_ONBOARD_I2C_EEPROM_WRITE_PROTECT_DISABLED_str(void);
 #define MSG_ONBOARD_I2C_EEPROM_WRITE_PROTECT_DISABLED bp_message_write_line(__builtin_tbladdress(MSG_ONBOARD_I2C_EEPROM_WRITE_PROTECT_DISABLED_str))
+void MSG_OPENOCD_MODE_IDENTIFIER_str(void);
+#define MSG_OPENOCD_MODE_IDENTIFIER bp_message_write_buffer(__builtin_tbladdress(MSG_OPENOCD_MODE_IDENTIFIER_str))
 void MSG_PIC_MODE_IDENTIFIER_str(void);
 #define MSG_PIC_MODE_IDENTIFIER bp_message_write_buffer(__builtin_tbladdress(MSG_PIC_MODE_IDENTIFIER_str))
 void MSG_PIC_UNKNOWN_MODE_str(void);
@@ -573,6 +581,8 @@ void MSG_SPI_SAMPLE_PROMPT_str(void);
 #define MSG_SPI_SAMPLE_PROMPT bp_message_write_line(__builtin_tbladdress(MSG_SPI_SAMPLE_PROMPT_str))
 void MSG_SPI_SPEED_PROMPT_str(void);
 #define MSG_SPI_SPEED_PROMPT bp_message_write_line(__builtin_tbladdress(MSG_SPI_SPEED_PROMPT_str))
+void MSG_SWD_MODE_IDENTIFIER_str(void);
+#define MSG_SWD_MODE_IDENTIFIER bp_message_write_buffer(__builtin_tbladdress(MSG_SWD_MODE_IDENTIFIER_str))
 void MSG_UART_MODE_IDENTIFIER_str(void);
 #define MSG_UART_MODE_IDENTIFIER bp_message_write_buffer(__builtin_tbladdress(MSG_UART_MODE_IDENTIFIER_str))
 void MSG_UART_NORMAL_TO_EXIT_str(void);
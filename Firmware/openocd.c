@@ -2,10 +2,6 @@
 
 #ifdef BP_JTAG_OPENOCD_SUPPORT
 
-#ifdef BUSPIRATEV4
-#error "OpenOCD support for Bus Pirate v4 is not there yet!"
-#endif /* BUSPIRATEV4 */
-
 #include "base.h"
 #include "core.h"
 #include "binary_io.h"
@@ -53,10 +49,37 @@ extern bus_pirate_configuration_t bus_pirate_configuration;
 #define CMD_UART_SPEED    0x07
 #define CMD_JTAG_SPEED    0x08
 
+/*
+ * Runs a queue of commands in one go, to save on round trips.
+ *
+ * PC sends CMD_QUEUE, the queue length in bytes (MSB first, up to
+ * BP_TERMINAL_BUFFER_SIZE), and then the queue itself: any sequence of
+ * CMD_PORT_MODE, CMD_FEATURE, CMD_JTAG_SPEED, and CMD_TAP_SHIFT commands,
+ * laid out as they would be sent on their own. Shifts in a queue are not
+ * limited to 0x2000 bits, only by the queue length.
+ *
+ * The queue is checked as a whole before anything runs: if it is too long,
+ * has an unknown command, or ends in the middle of a command, nothing is
+ * executed. The Bus Pirate then answers CMD_QUEUE, 0x01 on success or 0x00
+ * on failure, the TDO data length in bytes (MSB first), and the TDO data of
+ * all shifts in order.
+ */
+#define CMD_QUEUE         0x09
+
+/* Marks a queue that cannot be executed. */
+#define QUEUE_INVALID     0xFFFF
+
 static void binOpenOCDPinMode(unsigned char mode);
 static void binOpenOCDHandleFeature(unsigned char feat, unsigned char action);
 static void binOpenOCDAnswer(unsigned char *buf, unsigned int len);
+static unsigned char binOpenOCDShiftByte(unsigned char tdi, unsigned char tms, unsigned char bits, unsigned int delay);
+static unsigned int binOpenOCDRunQueue(unsigned char *buf, unsigned int len, bool execute);
+#ifdef BUSPIRATEV3
 extern void binOpenOCDTapShiftFast(unsigned char *in_buf, unsigned char *out_buf, unsigned int bits, unsigned int delay);
+#endif /* BUSPIRATEV3 */
+#ifdef BUSPIRATEV4
+static void binOpenOCDTapShiftFast(unsigned int bits, unsigned int delay);
+#endif /* BUSPIRATEV4 */
 
 enum {
 	FEATURE_LED=0x01,
@@ -84,6 +107,7 @@ void binOpenOCD(void){
 	unsigned int i,j;
 	unsigned char inByte;
 	unsigned char inByte2;
+	bp_adc_channels_t readings;
 
 	OpenOCDJtagDelay = 1;
 
@@ -134,18 +158,15 @@ this will misbehave when polling is turned off in OpenOCD
 				buf[0] = CMD_READ_ADCS;
 				buf[1] = 8;
 				AD1CON1bits.ADON = 1; // turn ADC ON
-				i=bp_read_adc(12); // ADC pin
-				buf[2] = (unsigned char)(i>>8);
-				buf[3] = (unsigned char)(i);
-				i=bp_read_adc(11); // VEXT pin
-				buf[4] = (unsigned char)(i>>8);
-				buf[5] = (unsigned char)(i);
-				i=bp_read_adc(10); // V33 pin
-				buf[6] = (unsigned char)(i>>8);
-				buf[7] = (unsigned char)(i);
-				i=bp_read_adc(9); // V50 pin
-				buf[8] = (unsigned char)(i>>8);
-				buf[9] = (unsigned char)(i);
+				bp_read_adc_channels(&readings);
+				buf[2] = (unsigned char)(readings.probe>>8); // ADC pin
+				buf[3] = (unsigned char)(readings.probe);
+				buf[4] = (unsigned char)(readings.pullup>>8); // VEXT pin
+				buf[5] = (unsigned char)(readings.pullup);
+				buf[6] = (unsigned char)(readings.supply_3v3>>8); // V33 pin
+				buf[7] = (unsigned char)(readings.supply_3v3);
+				buf[8] = (unsigned char)(readings.supply_5v0>>8); // V50 pin
+				buf[9] = (unsigned char)(readings.supply_5v0);
 				AD1CON1bits.ADON = 0; // turn ADC OFF
 				binOpenOCDAnswer(buf, 10);
 				break;
@@ -191,9 +212,11 @@ this will misbehave when polling is turned off in OpenOCD
 
 				j = (inByte << 8) | inByte2; // number of bit sequences
 
+#ifdef BUSPIRATEV3
 				// this fixes possible buffer overflow
 				if (j > 0x2000) 
 					j = 0x2000;
+#endif /* BUSPIRATEV3 */
 
 				i = (j+7)/8; // number of bytes used
 				buf[0] = CMD_TAP_SHIFT;
@@ -201,6 +224,10 @@ this will misbehave when polling is turned off in OpenOCD
 				buf[2] = inByte2;
 				binOpenOCDAnswer(buf, 3);
 
+#ifdef BUSPIRATEV4
+				// data moves straight through the USB CDC buffers
+				binOpenOCDTapShiftFast(j, OpenOCDJtagDelay);
+#else
 				// prepare the interrupt transfer
 				UART1RXBuf = (unsigned char*)bus_pirate_configuration.terminal_input;
 				UART1RXToRecv = 2*i;
@@ -214,6 +241,39 @@ this will misbehave when polling is turned off in OpenOCD
 				IEC0bits.U1RXIE = 1;
 
 				binOpenOCDTapShiftFast(UART1RXBuf, UART1TXBuf, j, OpenOCDJtagDelay);
+#endif /* BUSPIRATEV4 */
+				break;
+			case CMD_QUEUE:
+				inByte=user_serial_read_byte();
+				inByte2=user_serial_read_byte();
+				j = (inByte << 8) | inByte2; // queue length
+
+				// always take the whole queue in, to stay in sync with the host
+				for (i=0; i < j; i++) {
+					inByte=user_serial_read_byte();
+					if (i < BP_TERMINAL_BUFFER_SIZE) {
+						buf[i] = inByte;
+					}
+				}
+
+				i = QUEUE_INVALID;
+				if (j <= BP_TERMINAL_BUFFER_SIZE) {
+					i = binOpenOCDRunQueue(buf, j, false);
+					if (i != QUEUE_INVALID) {
+						binOpenOCDRunQueue(buf, j, true);
+					}
+				}
+
+				user_serial_transmit_character(CMD_QUEUE);
+				if (i == QUEUE_INVALID) {
+					REPORT_IO_FAILURE();
+					i = 0;
+				} else {
+					REPORT_IO_SUCCESS();
+				}
+				user_serial_transmit_character(i >> 8);
+				user_serial_transmit_character(i);
+				binOpenOCDAnswer(buf, i);
 				break;
 			default:
 				buf[0] = 0x00; // unknown command
@@ -280,6 +340,143 @@ static void binOpenOCDAnswer(unsigned char *buf, unsigned int len) {
 	}
 }
 
+/*
+ * Shifts up to 8 TDI/TMS bit pairs out, LSB first, and returns the TDO bits
+ * sampled meanwhile, right-aligned. Same timing as the openocd_asm.s kernel.
+ *
+ * Pins are driven through the latch register to avoid read-modify-write
+ * issues on consecutive port writes.
+ */
+static unsigned char binOpenOCDShiftByte(unsigned char tdi, unsigned char tms, unsigned char bits, unsigned int delay) {
+	unsigned char tdo, bit;
+	unsigned int latch, cycles;
+
+	tdo = 0;
+	for (bit = 0; bit < bits; bit++) {
+		for (cycles = delay; cycles > 0; cycles--) {
+			Nop();
+		}
+
+		// clear TCK, then output TMS & TDI
+		IOLAT &= ~CLK;
+		latch = IOLAT & ~(MOSI | CS);
+		if (tdi & 1) {
+			latch |= MOSI;
+		}
+		if (tms & 1) {
+			latch |= CS;
+		}
+		IOLAT = latch;
+		tdi >>= 1;
+		tms >>= 1;
+
+		for (cycles = delay; cycles > 0; cycles--) {
+			Nop();
+		}
+
+		// set TCK, then sample TDO
+		IOLAT |= CLK;
+		tdo >>= 1;
+		if (IOPOR & MISO) {
+			tdo |= 0x80;
+		}
+	}
+
+	return tdo >> (8 - bits);
+}
+
+/*
+ * Checks (execute == false) or runs (execute == true) a command queue held in
+ * buf, returning the TDO data length or QUEUE_INVALID.
+ *
+ * TDO bytes are stored at the start of buf as shifts run. That never catches
+ * up with the queue data still to be read, as every TDO byte takes the place
+ * of two TDI/TMS bytes plus at least a three bytes command header.
+ */
+static unsigned int binOpenOCDRunQueue(unsigned char *buf, unsigned int len, bool execute) {
+	unsigned int in, out, bytes, byte, bits;
+	unsigned char count;
+
+	in = 0;
+	out = 0;
+	while (in < len) {
+		switch (buf[in]) {
+			case CMD_PORT_MODE:
+				if (len - in < 2)
+					return QUEUE_INVALID;
+				if (execute)
+					binOpenOCDPinMode(buf[in + 1]);
+				in += 2;
+				break;
+			case CMD_FEATURE:
+				if (len - in < 3)
+					return QUEUE_INVALID;
+				if (execute)
+					binOpenOCDHandleFeature(buf[in + 1], buf[in + 2]);
+				in += 3;
+				break;
+			case CMD_JTAG_SPEED:
+				if (len - in < 3)
+					return QUEUE_INVALID;
+				if (execute)
+					OpenOCDJtagDelay = (buf[in + 1] << 8) | buf[in + 2];
+				in += 3;
+				break;
+			case CMD_TAP_SHIFT:
+				if (len - in < 3)
+					return QUEUE_INVALID;
+				bits = (buf[in + 1] << 8) | buf[in + 2];
+				in += 3;
+				bytes = (bits >> 3) + ((bits & 7) ? 1 : 0);
+				if ((len - in) / 2 < bytes)
+					return QUEUE_INVALID;
+				if (execute) {
+					for (byte = 0; byte < bytes; byte++) {
+						count = (bits > 8) ? 8 : bits;
+						bits -= count;
+						buf[out + byte] = binOpenOCDShiftByte(buf[in + (2 * byte)], buf[in + (2 * byte) + 1], count, OpenOCDJtagDelay);
+					}
+				}
+				in += 2 * bytes;
+				out += bytes;
+				break;
+			default:
+				return QUEUE_INVALID;
+		}
+	}
+
+	return out;
+}
+
+#ifdef BUSPIRATEV4
+
+/*
+ * Port of the openocd_asm.s TAP shift kernel for the v4 USB CDC interface.
+ *
+ * The host sends a TDI byte and a TMS byte for every 8 bits, LSB first. Those
+ * are taken straight from the CDC OUT double buffer, and TDO bytes are put
+ * straight into the CDC IN double buffer, so while one USB buffer is shifted
+ * out on the pins the other one is being filled or emptied by the USB engine.
+ * Nothing is staged in the terminal buffer, so there is no limit on the
+ * number of bits besides the 16 bits count.
+ */
+static void binOpenOCDTapShiftFast(unsigned int bits, unsigned int delay) {
+	unsigned char tdi, tms, count;
+
+	while (bits > 0) {
+		tdi = getc_cdc();
+		tms = getc_cdc();
+		count = (bits > 8) ? 8 : bits;
+		bits -= count;
+		putc_cdc(binOpenOCDShiftByte(tdi, tms, count, delay));
+	}
+
+	// don't wait for the flush timeout, OpenOCD is waiting for the data
+	CDC_Flush_In_Now();
+}
+
+#endif /* BUSPIRATEV4 */
+
 static void binOpenOCDHandleFeature(unsigned char feat, unsigned char action) {
 	switch (feat) {
 		case FEATURE_LED:
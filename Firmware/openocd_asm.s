@@ -15,7 +15,7 @@
 ;
 
 .ifdef __PIC24FJ256GB106__
-	.error "Bus Pirate v4 is not yet supported!"
+	.error "Bus Pirate v4 uses the USB CDC TAP shift kernel in openocd.c!"
 .endif ; __PIC24FJ256GB106__
 
 .ifdef __PIC24FJ64GA002__
@@ -27,6 +27,7 @@
 #include "binary_io.h"
 #include "sump.h"
 #include "basic.h"
+#include "bus_timing.h"
 
 extern bus_pirate_configuration_t bus_pirate_configuration;
 extern mode_configuration_t mode_configuration;
@@ -87,6 +88,76 @@ static void print_pin_direction(uint16_t pin);
  */
 static void print_pin_state(uint16_t pin);
 
+#ifdef BP_ENABLE_COMMAND_COMPILER
+
+/**
+ * Bus commands a command line can be compiled to.
+ */
+typedef enum {
+    OPERATION_START = 0,
+    OPERATION_START_WITH_READ,
+    OPERATION_STOP,
+    OPERATION_STOP_FROM_READ,
+    OPERATION_WRITE,
+    OPERATION_READ,
+    OPERATION_CLOCK_HIGH,
+    OPERATION_CLOCK_LOW,
+    OPERATION_DATA_HIGH,
+    OPERATION_DATA_LOW,
+    OPERATION_DATA_STATE,
+    OPERATION_CLOCK_PULSE,
+    OPERATION_READ_BIT,
+    OPERATION_DELAY_US,
+    OPERATION_DELAY_MS,
+    OPERATION_AUX_LOW,
+    OPERATION_AUX_HIGH,
+    OPERATION_AUX_READ
+} __attribute__((packed)) operation_type_t;
+
+/**
+ * A compiled bus command, with its arguments already parsed.
+ */
+typedef struct {
+    /** The command to run. */
+    operation_type_t type;
+    /** Bits per value given with ";", 0 if none was given. */
+    uint8_t bits;
+    /** Value to write. */
+    uint16_t value;
+    /** Repeat count given with ":", or the delay length. */
+    uint16_t repeat;
+} compiled_operation_t;
+
+/**
+ * The last command line compiled.
+ */
+typedef struct {
+    /** The compiled bus commands. */
+    compiled_operation_t operations[BP_COMPILED_COMMAND_MAX_OPERATIONS];
+    /** The command line text the operations were compiled from. */
+    char line[BP_COMMAND_BUFFER_SIZE];
+    /** How many operations are in use. */
+    uint8_t count;
+    /** Whether the operations hold a compiled command line. */
+    bool valid;
+} compiled_command_t;
+
+static compiled_command_t compiled_command;
+
+/**
+ * Runs the command line between cmdstart and cmdend from its compiled form,
+ * compiling it first unless it is the same line as the last one compiled.
+ *
+ * The output is the same as when the interpreter runs the line, without
+ * parsing the text between two bus commands.
+ *
+ * @return true if the line was run, false if it holds something else than bus
+ * commands or has a syntax error, the interpreter must then run it.
+ */
+static bool run_compiled_command_line(void);
+
+#endif /* BP_ENABLE_COMMAND_COMPILER */
+
 #ifdef BUSPIRATEV4
 void setPullupVoltage(void); // onboard Vpu selection
 #endif /* BUSPIRATEV4 */
@@ -509,6 +580,19 @@ end:
         }
 #endif /* BP_ENABLE_BASIC_SUPPORT */
 
+        /* Keep talking to the bus while earlier results are being sent. */
+        user_serial_set_output_buffering(YES);
+
+#ifdef BP_ENABLE_BUS_TIMING
+        bp_bus_timing_begin();
+#endif /* BP_ENABLE_BUS_TIMING */
+
+#ifdef BP_ENABLE_COMMAND_COMPILER
+        if (!stop && run_compiled_command_line()) {
+            stop = 1;
+        }
+#endif /* BP_ENABLE_COMMAND_COMPILER */
+
         oldDmode=0;//temporarily holds the default display mode, while a different display read is performed
         newDmode=0;
         while (!stop) {
@@ -549,6 +633,11 @@ end:
                 case 'f': //bpWline("-frequency count on AUX");
                     bp_frequency_counter_setup();
                     break;
+#ifdef BP_ENABLE_BUS_TIMING
+                case 't': //bpWline("-bus operation timings of the last line");
+                    bp_bus_timing_report();
+                    break;
+#endif /* BP_ENABLE_BUS_TIMING */
                 case 'g':
                     if (bus_pirate_configuration.bus_mode == BP_HIZ) { //bpWmessage(MSG_ERROR_MODE);
                         BPMSG1088;
@@ -1039,6 +1128,12 @@ bpv4reset:
             if (cmdstart == cmdend) stop = 1; // reached end of user input??
         } //while(!stop)
 
+#ifdef BP_ENABLE_BUS_TIMING
+        bp_bus_timing_end();
+#endif /* BP_ENABLE_BUS_TIMING */
+
+        user_serial_set_output_buffering(NO);
+
 
         cmdstart = newstart;
         cmdend = newstart; // 'empty' cmdbuffer
@@ -1637,7 +1732,9 @@ void statusInfo(void) {
     BPMSG1119;
 } //statusInfo(void)
 
-void print_pins_information(void) { 
+void print_pins_information(void) {
+    bp_adc_channels_t readings;
+
     //bpWline("Pinstates:");
     BPMSG1226;
 #ifdef BUSPIRATEV4
@@ -1668,43 +1765,44 @@ void print_pins_information(void) {
     bpBR;
     BPMSG1234; //bpWstring("GND\t");
     ADCON();
+    bp_read_adc_channels(&readings);
 
 #ifdef BUSPIRATEV4
-    bp_write_voltage(bp_read_adc(BP_ADC_5V0));
+    bp_write_voltage(readings.supply_5v0);
 #else
 #if defined(BP_VERSION2_SUPPORT) && (BP_VERSION2_SUPPORT == 1)
-    bp_write_voltage(bp_read_adc(BP_ADC_PROBE));
+    bp_write_voltage(readings.probe);
 #else
-    bp_write_voltage(bp_read_adc(BP_ADC_3V3));
+    bp_write_voltage(readings.supply_3v3);
 #endif /* BP_VERSION2_SUPPORT && (BP_VERSION2_SUPPORT == 1) */
 #endif /* BUSPIRATEV4 */
     MSG_VOLTAGE_UNIT;
     user_serial_transmit_character('\t');
 
 #ifdef BUSPIRATEV4
-    bp_write_voltage(bp_read_adc(BP_ADC_3V3));
+    bp_write_voltage(readings.supply_3v3);
 #else
-    bp_write_voltage(bp_read_adc(BP_ADC_5V0));
+    bp_write_voltage(readings.supply_5v0);
 #endif /* BUSPIRATEV4 */
     MSG_VOLTAGE_UNIT;
     user_serial_transmit_character('\t');
 
 #ifdef BUSPIRATEV4
-    bp_write_voltage(bp_read_adc(BP_ADC_VPU));
+    bp_write_voltage(readings.pullup);
 #else
 #if defined(BP_VERSION2_SUPPORT) && (BP_VERSION2_SUPPORT == 1)
-    bp_write_voltage(bp_read_adc(BP_ADC_3V3));
+    bp_write_voltage(readings.supply_3v3);
 #else
-    bp_write_voltage(bp_read_adc(BP_ADC_PROBE));
+    bp_write_voltage(readings.probe);
 #endif /* BP_VERSION2_SUPPORT && (BP_VERSION2_SUPPORT == 1) */
 #endif /* BUSPIRATEV4 */
     MSG_VOLTAGE_UNIT;
     user_serial_transmit_character('\t');
 
 #ifdef BUSPIRATEV4
-    bp_write_voltage(bp_read_adc(BP_ADC_PROBE));
+    bp_write_voltage(readings.probe);
 #else
-    bp_write_voltage(bp_read_adc(BP_ADC_VPU));
+    bp_write_voltage(readings.pullup);
 #endif /* BUSPIRATEV4 */
     MSG_VOLTAGE_UNIT;
     user_serial_transmit_character('\t');
@@ -1880,3 +1978,363 @@ void setPullupVoltage(void) {
 }
 
 #endif /* BUSPIRATEV4 */
+
+#ifdef BP_ENABLE_COMMAND_COMPILER
+
+/**
+ * Compiles the command line between cmdstart and cmdend, parsing it the same
+ * way as the interpreter does.
+ *
+ * @return true if the line only holds bus commands without syntax errors.
+ */
+static bool compile_command_line(void) {
+    compiled_operation_t *operation;
+    unsigned int start;
+    unsigned int length;
+    bool compiled;
+
+    start = cmdstart;
+    compiled = true;
+    compiled_command.count = 0;
+    compiled_command.valid = false;
+
+    for (length = 0; compiled && (length < BP_COMMAND_BUFFER_SIZE) && (cmdstart != cmdend); length++) {
+        switch (cmdbuf[cmdstart]) {
+            case 0x00:
+            case 0x0D:
+            case 0x0A:
+            case ' ':
+            case ',':
+                cmdstart = (cmdstart + 1) & CMDLENMSK;
+                continue;
+        }
+
+        if (compiled_command.count == BP_COMPILED_COMMAND_MAX_OPERATIONS) {
+            compiled = false;
+            break;
+        }
+
+        operation = &compiled_command.operations[compiled_command.count];
+        operation->bits = 0;
+        operation->value = 0;
+        operation->repeat = 1;
+
+        switch (cmdbuf[cmdstart]) {
+            case '[':
+                operation->type = OPERATION_START;
+                break;
+            case '{':
+                operation->type = OPERATION_START_WITH_READ;
+                break;
+            case ']':
+                operation->type = OPERATION_STOP;
+                break;
+            case '}':
+                operation->type = OPERATION_STOP_FROM_READ;
+                break;
+            case '0':
+            case '1':
+            case '2':
+            case '3':
+            case '4':
+            case '5':
+            case '6':
+            case '7':
+            case '8':
+            case '9':
+                operation->type = OPERATION_WRITE;
+                operation->value = getint();
+                cmdstart = (cmdstart - 1) & CMDLENMSK;
+                operation->repeat = getrepeat();
+                operation->bits = getnumbits();
+                break;
+            case 'r':
+                /* Display overrides are left to the interpreter. */
+                if (change_read_display()) {
+                    compiled = false;
+                    break;
+                }
+                operation->type = OPERATION_READ;
+                operation->repeat = getrepeat();
+                operation->bits = getnumbits();
+                break;
+            case '/':
+                operation->type = OPERATION_CLOCK_HIGH;
+                break;
+            case '\\':
+                operation->type = OPERATION_CLOCK_LOW;
+                break;
+            case '-':
+                operation->type = OPERATION_DATA_HIGH;
+                break;
+            case '_':
+                operation->type = OPERATION_DATA_LOW;
+                break;
+            case '.':
+                operation->type = OPERATION_DATA_STATE;
+                break;
+            case '^':
+                operation->type = OPERATION_CLOCK_PULSE;
+                operation->repeat = getrepeat();
+                break;
+            case '!':
+                operation->type = OPERATION_READ_BIT;
+                operation->repeat = getrepeat();
+                break;
+            case '&':
+                operation->type = OPERATION_DELAY_US;
+                operation->repeat = getrepeat();
+                break;
+            case '%':
+                operation->type = OPERATION_DELAY_MS;
+                operation->repeat = getrepeat();
+                break;
+            case 'a':
+                operation->type = OPERATION_AUX_LOW;
+                operation->repeat = getrepeat();
+                break;
+            case 'A':
+                operation->type = OPERATION_AUX_HIGH;
+                operation->repeat = getrepeat();
+                break;
+            case '@':
+                operation->type = OPERATION_AUX_READ;
+                operation->repeat = getrepeat();
+                break;
+            default:
+                compiled = false;
+                break;
+        }
+
+        if (command_error) {
+            compiled = false;
+        }
+        compiled_command.count++;
+        cmdstart = (cmdstart + 1) & CMDLENMSK;
+    }
+
+    compiled = compiled && (cmdstart == cmdend);
+    command_error = false;
+    cmdstart = start;
+
+    if (!compiled) {
+        return false;
+    }
+
+    /* Keep the text as parsed, hex digits may have been lowercased. */
+    for (length = 0; start != cmdend; length++) {
+        compiled_command.line[length] = cmdbuf[start];
+        start = (start + 1) & CMDLENMSK;
+    }
+    compiled_command.line[length] = 0x00;
+    compiled_command.valid = true;
+
+    return true;
+}
+
+/**
+ * Checks whether the command line between cmdstart and cmdend is the one
+ * the operations were compiled from.
+ */
+static bool is_compiled_command_line(void) {
+    unsigned int position;
+    unsigned int length;
+
+    if (!compiled_command.valid) {
+        return false;
+    }
+
+    position = cmdstart;
+    for (length = 0; position != cmdend; length++) {
+        if (cmdbuf[position] != compiled_command.line[length]) {
+            return false;
+        }
+        position = (position + 1) & CMDLENMSK;
+    }
+
+    return compiled_command.line[length] == 0x00;
+}
+
+/**
+ * Applies the bits per value given with ";", as the interpreter does.
+ */
+static void set_compiled_number_of_bits(const uint8_t bits) {
+    if (bits) {
+        mode_configuration.numbits = bits;
+        mode_configuration.int16 = (bits > 8) ? 1 : 0;
+    }
+}
+
+/**
+ * Shows the bits per value after a value, if not the default ones.
+ */
+static void print_compiled_number_of_bits(void) {
+    if (((mode_configuration.int16 == 0) && (mode_configuration.numbits != 8)) ||
+            ((mode_configuration.int16 == 1) && (mode_configuration.numbits != 16))) {
+        user_serial_transmit_character(';');
+        bp_write_dec_byte(mode_configuration.numbits);
+    }
+}
+
+bool run_compiled_command_line(void) {
+    const compiled_operation_t *operation;
+    const bus_pirate_protocol_t *protocol;
+    unsigned int sendw, received;
+    int repeat;
+    uint8_t index;
+
+    if (cmdstart == cmdend) {
+        return false;
+    }
+
+    if (!is_compiled_command_line() && !compile_command_line()) {
+        return false;
+    }
+
+    protocol = &enabled_protocols[bus_pirate_configuration.bus_mode];
+    for (index = 0; index < compiled_command.count; index++) {
+        operation = &compiled_command.operations[index];
+
+        switch (operation->type) {
+            case OPERATION_START:
+                protocol->start();
+                break;
+
+            case OPERATION_START_WITH_READ:
+                protocol->start_with_read();
+                break;
+
+            case OPERATION_STOP:
+                protocol->stop();
+                break;
+
+            case OPERATION_STOP_FROM_READ:
+                protocol->stop_from_read();
+                break;
+
+            case OPERATION_WRITE:
+                BPMSG1101;
+                sendw = operation->value;
+                set_compiled_number_of_bits(operation->bits);
+                repeat = operation->repeat + 1;
+                while (--repeat) {
+                    bp_write_formatted_integer(sendw);
+                    print_compiled_number_of_bits();
+                    if (mode_configuration.lsbEN == 1) {
+                        sendw = bp_reverse_integer(sendw, mode_configuration.numbits);
+                    }
+                    received = protocol->send(sendw);
+                    bpSP;
+                    if (mode_configuration.write_with_read) {
+                        BPMSG1102;
+                        if (mode_configuration.lsbEN == 1) {
+                            received = bp_reverse_integer(received, mode_configuration.numbits);
+                        }
+                        bp_write_formatted_integer(received);
+                        bpSP;
+                    }
+                }
+                bpBR;
+                break;
+
+            case OPERATION_READ:
+                BPMSG1102;
+                set_compiled_number_of_bits(operation->bits);
+                repeat = operation->repeat + 1;
+                while (--repeat) {
+                    received = protocol->read();
+                    if (mode_configuration.lsbEN == 1) {
+                        received = bp_reverse_integer(received, mode_configuration.numbits);
+                    }
+                    bp_write_formatted_integer(received);
+                    print_compiled_number_of_bits();
+                    bpSP;
+                }
+                bpBR;
+                break;
+
+            case OPERATION_CLOCK_HIGH:
+                BPMSG1103;
+                protocol->clock_high();
+                break;
+
+            case OPERATION_CLOCK_LOW:
+                BPMSG1104;
+                protocol->clock_low();
+                break;
+
+            case OPERATION_DATA_HIGH:
+                BPMSG1105;
+                protocol->data_high();
+                break;
+
+            case OPERATION_DATA_LOW:
+                BPMSG1106;
+                protocol->data_low();
+                break;
+
+            case OPERATION_DATA_STATE:
+                BPMSG1098;
+                echo_state(protocol->data_state());
+                break;
+
+            case OPERATION_CLOCK_PULSE:
+                repeat = operation->repeat;
+                BPMSG1108;
+                bp_write_formatted_integer(repeat);
+                repeat++;
+                while (--repeat) {
+                    protocol->clock_pulse();
+                }
+                bpBR;
+                break;
+
+            case OPERATION_READ_BIT:
+                repeat = operation->repeat + 1;
+                BPMSG1109;
+                while (--repeat) {
+                    echo_state(protocol->read_bit());
+                    bpSP;
+                }
+                BPMSG1107;
+                break;
+
+            case OPERATION_DELAY_US:
+                BPMSG1099;
+                bp_write_dec_word(operation->repeat);
+                BPMSG1100;
+                bp_delay_us(operation->repeat);
+                break;
+
+            case OPERATION_DELAY_MS:
+                BPMSG1099;
+                bp_write_dec_word(operation->repeat);
+                BPMSG1212;
+                bp_delay_ms(operation->repeat);
+                break;
+
+            case OPERATION_AUX_LOW:
+                repeat = operation->repeat + 1;
+                while (--repeat) bp_aux_pin_set_low();
+                break;
+
+            case OPERATION_AUX_HIGH:
+                repeat = operation->repeat + 1;
+                while (--repeat) bp_aux_pin_set_high();
+                break;
+
+            case OPERATION_AUX_READ:
+                repeat = operation->repeat + 1;
+                while (--repeat) {
+                    BPMSG1095;
+                    echo_state(bp_aux_pin_read());
+                    bpBR;
+                }
+                break;
+        }
+    }
+
+    return true;
+}
+
+#endif /* BP_ENABLE_COMMAND_COMPILER */
@@ -0,0 +1,734 @@
+/*
+ * This file is part of the Bus Pirate project
+ * (http://code.google.com/p/the-bus-pirate/).
+ *
+ * Written and maintained by the Bus Pirate project.
+ *
+ * To the extent possible under law, the project has waived all copyright and
+ * related or neighboring rights to Bus Pirate.  This work is published from
+ * United States.
+ *
+ * For details see: http://creativecommons.org/publicdomain/zero/1.0/
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.
+ */
+
+/**
+ * @file swd.c
+ *
+ * @brief ARM Serial Wire Debug protocol handler implementation file.
+ *
+ * The protocol engine sits on top of the bit-banging module running in 2-wire
+ * mode: SWCLK is on the CLK pin and SWDIO is on the MOSI pin.  Request packet
+ * parity, line turnaround, acknowledgement decoding, data parity checking and
+ * WAIT retries are all handled on the board, so the host only has to send
+ * lists of DP/AP register accesses and collect the results.
+ *
+ * Bits go on the wire LSB first.  SWDIO is set up while SWCLK is low and the
+ * target samples it on the rising edge; data coming from the target is sampled
+ * while SWCLK is low, before the rising edge that shifts the next bit out.
+ *
+ * More information in the ARM Debug Interface Architecture Specification
+ * (ADIv5), chapter 4 (The Serial Wire Debug Port).
+ */
+
+#include "swd.h"
+
+#ifdef BP_ENABLE_SWD_SUPPORT
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "base.h"
+#include "binary_io.h"
+#include "bitbang.h"
+#include "core.h"
+
+extern mode_configuration_t mode_configuration;
+extern bus_pirate_configuration_t bus_pirate_configuration;
+
+/**
+ * @brief Binary I/O SWD Action command.
+ *
+ * Current form is as follows:
+ *
+ * <table><tr><th>Bits</th><th>Meaning</th></tr>
+ * <tr><td>`7:4`</td><td>Set to `0b0000`.</td></tr>
+ * <tr><td>`3:0`</td><td>The action identifier:
+ * * `0b0000` : BINARY_IO_SWD_ACTION_EXIT.
+ * * `0b0001` : BINARY_IO_SWD_ACTION_VERSION_STRING.
+ * * `0b0010` : BINARY_IO_SWD_ACTION_JTAG_TO_SWD.
+ * * `0b0011` : BINARY_IO_SWD_ACTION_LINE_RESET.
+ * * `0b0100` : BINARY_IO_SWD_ACTION_SET_WAIT_RETRIES.
+ * * `0b0101` : BINARY_IO_SWD_ACTION_SET_IDLE_CYCLES.
+ * * `0b0110` : BINARY_IO_SWD_ACTION_TRANSFER_LIST.
+ * * `0b0111` : BINARY_IO_SWD_ACTION_BLOCK_READ.
+ * * `0b1000` to `0b1111` : Reserved.
+ * </td></tr></table>
+ */
+#define BINARY_IO_SWD_COMMAND_ACTION 0x00
+
+/**
+ * @brief Binary I/O SWD Peripherals configuration command.
+ *
+ * Same as the raw-wire mode one: `0b0100wxyz`, where `w` is power, `x` is
+ * pull-ups, `y` is AUX and `z` is CS.  AUX can be wired to the target's
+ * nRESET line.  Responds with a SUCCESS value.
+ */
+#define BINARY_IO_SWD_COMMAND_CONFIGURE_PERIPHERALS 0x04
+
+#ifdef BUSPIRATEV4
+
+/**
+ * @brief Binary I/O SWD Pull-up voltage selection command.
+ *
+ * Same as the raw-wire mode one, available only on Bus Pirate v4.
+ */
+#define BINARY_IO_SWD_COMMAND_PULLUP_CONTROL 0x05
+
+#endif /* BUSPIRATEV4 */
+
+/**
+ * @brief Binary I/O SWD Bus speed command.
+ *
+ * Current form is `0b011000ss`, where `ss` is the bit-banging bus speed
+ * (5kHz, 50kHz, 100kHz, maximum).  Responds with a SUCCESS value.
+ *
+ * @see bp_bitbang_speed_t
+ */
+#define BINARY_IO_SWD_COMMAND_SET_SPEED 0x06
+
+/**
+ * @brief Binary I/O SWD Configuration command.
+ *
+ * Current form is `0b1000w000`, where `w` selects the pins output type: `0`
+ * for open drain (HiZ) and `1` for normal (3.3v) outputs.  Responds with a
+ * SUCCESS value.
+ */
+#define BINARY_IO_SWD_COMMAND_CONFIGURE 0x08
+
+/**
+ * @brief Binary I/O SWD Action command to exit SWD mode.
+ *
+ * <table><tr><td>PC</td><td>&rarr;</td><td>Bus Pirate</td>
+ * <td>`0b00000000`</td></tr>
+ * <tr><td>PC</td><td><center>&times;</center></td><td>Bus Pirate</td>
+ * <td>The Bus Pirate is now back in binary bitbang mode.</td></tr></table>
+ */
+#define BINARY_IO_SWD_ACTION_EXIT 0x00
+
+/**
+ * @brief Binary I/O SWD Action command to print out the mode version string.
+ *
+ * <table><tr><td>PC</td><td>&rarr;</td><td>Bus Pirate</td>
+ * <td>`0b00000001`</td></tr>
+ * <tr><td>PC</td><td>&larr;</td><td>Bus Pirate</td>
+ * <td>ASCII `SWD1`.</td></tr></table>
+ */
+#define BINARY_IO_SWD_ACTION_VERSION_STRING 0x01
+
+/**
+ * @brief Binary I/O SWD Action command to switch a SWJ-DP from JTAG to SWD.
+ *
+ * Sends a line reset, the `0xE79E` JTAG-to-SWD selection sequence, another
+ * line reset, and then idles the line.  The host is expected to read DPIDR
+ * right afterwards.
+ *
+ * <table><tr><td>PC</td><td>&rarr;</td><td>Bus Pirate</td>
+ * <td>`0b00000010`</td></tr>
+ * <tr><td>PC</td><td>&larr;</td><td>Bus Pirate</td>
+ * <td>`0b00000001` (SUCCESS).</td></tr></table>
+ */
+#define BINARY_IO_SWD_ACTION_JTAG_TO_SWD 0x02
+
+/**
+ * @brief Binary I/O SWD Action command to perform a line reset.
+ *
+ * <table><tr><td>PC</td><td>&rarr;</td><td>Bus Pirate</td>
+ * <td>`0b00000011`</td></tr>
+ * <tr><td>PC</td><td>&larr;</td><td>Bus Pirate</td>
+ * <td>`0b00000001` (SUCCESS).</td></tr></table>
+ */
+#define BINARY_IO_SWD_ACTION_LINE_RESET 0x03
+
+/**
+ * @brief Binary I/O SWD Action command to set how many times a transfer
+ * answered with WAIT is retried before giving up.
+ *
+ * <table><tr><td>PC</td><td>&rarr;</td><td>Bus Pirate</td>
+ * <td>`0b00000100`</td></tr>
+ * <tr><td>PC</td><td>&rarr;</td><td>Bus Pirate</td>
+ * <td>Retries count, 0 to 255.</td></tr>
+ * <tr><td>PC</td><td>&larr;</td><td>Bus Pirate</td>
+ * <td>`0b00000001` (SUCCESS).</td></tr></table>
+ */
+#define BINARY_IO_SWD_ACTION_SET_WAIT_RETRIES 0x04
+
+/**
+ * @brief Binary I/O SWD Action command to set how many idle cycles (SWDIO
+ * driven LOW) are clocked after every transfer.
+ *
+ * <table><tr><td>PC</td><td>&rarr;</td><td>Bus Pirate</td>
+ * <td>`0b00000101`</td></tr>
+ * <tr><td>PC</td><td>&rarr;</td><td>Bus Pirate</td>
+ * <td>Idle cycles count, 0 to 255.</td></tr>
+ * <tr><td>PC</td><td>&larr;</td><td>Bus Pirate</td>
+ * <td>`0b00000001` (SUCCESS).</td></tr></table>
+ */
+#define BINARY_IO_SWD_ACTION_SET_IDLE_CYCLES 0x05
+
+/**
+ * @brief Binary I/O SWD Action command to run a list of register transfers.
+ *
+ * The list is buffered on the board first, and then executed in order,
+ * stopping at the first transfer that does not complete.  Each list entry is
+ * a request byte, followed by the value to write (little endian) for write
+ * requests only.  The request byte is laid out as follows:
+ *
+ * <table><tr><th>Bits</th><th>Meaning</th></tr>
+ * <tr><td>`7:4`</td><td>Reserved, set to `0b0000`.</td></tr>
+ * <tr><td>`3:2`</td><td>Register address bits A[3:2].</td></tr>
+ * <tr><td>`1`</td><td>RnW: `1` for reads, `0` for writes.</td></tr>
+ * <tr><td>`0`</td><td>APnDP: `1` for AP registers, `0` for DP registers.</td>
+ * </tr></table>
+ *
+ * The result byte holds the last acknowledgement received (`0b001` OK,
+ * `0b010` WAIT once retries ran out, `0b100` FAULT, anything else a protocol
+ * error such as `0b111` for a missing target), or SWD_RESULT_PARITY_ERROR.
+ *
+ * Interaction flow is as follows:
+ *
+ * <table><tr><td>PC</td><td>&rarr;</td><td>Bus Pirate</td>
+ * <td>`0b00000110`</td></tr>
+ * <tr><td>PC</td><td>&rarr;</td><td>Bus Pirate</td>
+ * <td>Transfers count (16 bits, MSB first), 1 to SWD_MAXIMUM_TRANSFERS.
+ * Any other value is refused with `0b00000000` (FAILURE) straight away.</td>
+ * </tr>
+ * <tr><td>PC</td><td>&rarr;</td><td>Bus Pirate</td>
+ * <td>List entries.</td></tr>
+ * <tr><td>PC</td><td>&larr;</td><td>Bus Pirate</td>
+ * <td>`0b00000001` (SUCCESS) if all transfers completed, `0b00000000`
+ * (FAILURE) otherwise.</td></tr>
+ * <tr><td>PC</td><td>&larr;</td><td>Bus Pirate</td>
+ * <td>Completed transfers count (16 bits, MSB first).</td></tr>
+ * <tr><td>PC</td><td>&larr;</td><td>Bus Pirate</td>
+ * <td>Result byte.</td></tr>
+ * <tr><td>PC</td><td>&larr;</td><td>Bus Pirate</td>
+ * <td>Four bytes (little endian) for every completed read, in order.</td>
+ * </tr></table>
+ */
+#define BINARY_IO_SWD_ACTION_TRANSFER_LIST 0x06
+
+/**
+ * @brief Binary I/O SWD Action command to read the same register repeatedly.
+ *
+ * This is meant for memory block reads through the MEM-AP DRW register with
+ * TAR auto-increment enabled.  Remember that AP reads are posted: the first
+ * value returned is stale, and the last one has to be fetched from RDBUFF.
+ *
+ * Interaction flow is as follows:
+ *
+ * <table><tr><td>PC</td><td>&rarr;</td><td>Bus Pirate</td>
+ * <td>`0b00000111`</td></tr>
+ * <tr><td>PC</td><td>&rarr;</td><td>Bus Pirate</td>
+ * <td>Request byte, as in BINARY_IO_SWD_ACTION_TRANSFER_LIST (RnW is forced
+ * on).</td></tr>
+ * <tr><td>PC</td><td>&rarr;</td><td>Bus Pirate</td>
+ * <td>Reads count (16 bits, MSB first), 1 to SWD_MAXIMUM_BLOCK_READS.  Any
+ * other value is refused with `0b00000000` (FAILURE) straight away.</td></tr>
+ * <tr><td>PC</td><td>&larr;</td><td>Bus Pirate</td>
+ * <td>Status, completed count and result byte, as in
+ * BINARY_IO_SWD_ACTION_TRANSFER_LIST.</td></tr>
+ * <tr><td>PC</td><td>&larr;</td><td>Bus Pirate</td>
+ * <td>Four bytes (little endian) for every completed read, in order.</td>
+ * </tr></table>
+ */
+#define BINARY_IO_SWD_ACTION_BLOCK_READ 0x07
+
+/**
+ * Request bit selecting an AP register rather than a DP one.
+ */
+#define SWD_REQUEST_APNDP 0x01
+
+/**
+ * Request bit selecting a register read rather than a write.
+ */
+#define SWD_REQUEST_RNW 0x02
+
+/**
+ * Request bits that are sent over the wire, APnDP, RnW, and A[3:2].
+ */
+#define SWD_REQUEST_MASK 0x0F
+
+/**
+ * Request packet start bit, always set.
+ */
+#define SWD_PACKET_START 0x01
+
+/**
+ * Request packet parity bit, covering APnDP, RnW, and A[3:2].
+ */
+#define SWD_PACKET_PARITY 0x20
+
+/**
+ * Request packet park bit, always set.
+ */
+#define SWD_PACKET_PARK 0x80
+
+/**
+ * Acknowledgement for a completed transfer.
+ */
+#define SWD_ACK_OK 0x01
+
+/**
+ * Acknowledgement for a transfer the target cannot handle yet.
+ */
+#define SWD_ACK_WAIT 0x02
+
+/**
+ * Acknowledgement for a transfer rejected because of a sticky error flag.
+ */
+#define SWD_ACK_FAULT 0x04
+
+/**
+ * Result code for read data not matching its parity bit.
+ */
+#define SWD_RESULT_PARITY_ERROR 0x08
+
+/**
+ * Clock cycles with SWDIO HIGH needed for a line reset (at least 50).
+ */
+#define SWD_LINE_RESET_CYCLES 56
+
+/**
+ * Idle cycles to clock after a line reset, before the next request.
+ */
+#define SWD_LINE_RESET_IDLE_CYCLES 2
+
+/**
+ * SWJ-DP selection sequence switching from JTAG to SWD, sent LSB first.
+ */
+#define SWD_JTAG_TO_SWD_SEQUENCE 0xE79E
+
+/**
+ * Default number of retries for transfers answered with WAIT.
+ */
+#define SWD_DEFAULT_WAIT_RETRIES 100
+
+/**
+ * Default number of idle cycles to clock after every transfer.
+ */
+#define SWD_DEFAULT_IDLE_CYCLES 2
+
+/**
+ * Buffer space taken by each transfer list entry: one request byte and four
+ * value bytes.  Read results are stored in the value bytes of their own entry.
+ */
+#define SWD_TRANSFER_SLOT_SIZE 5
+
+/**
+ * How many transfers can fit in a single list.
+ */
+#define SWD_MAXIMUM_TRANSFERS (BP_TERMINAL_BUFFER_SIZE / SWD_TRANSFER_SLOT_SIZE)
+
+/**
+ * How many reads can fit in a single block read.
+ */
+#define SWD_MAXIMUM_BLOCK_READS (BP_TERMINAL_BUFFER_SIZE / sizeof(uint32_t))
+
+/**
+ * SWD protocol engine state.
+ */
+static struct {
+  /**
+   * How many times a transfer answered with WAIT is retried.
+   */
+  uint8_t wait_retries;
+
+  /**
+   * How many idle cycles are clocked after every transfer.
+   */
+  uint8_t idle_cycles;
+} swd_state;
+
+/**
+ * Computes the even parity of the given value.
+ *
+ * @param[in] value the value to compute the parity of.
+ *
+ * @return true if the value has an odd number of bits set, false otherwise.
+ */
+static bool swd_parity(uint32_t value);
+
+/**
+ * Clocks the given bits out on SWDIO, LSB first.
+ *
+ * @param[in] value the bits to send.
+ * @param[in] bits how many bits to send, any bit past the 32nd is sent as 0.
+ */
+static void swd_write_bits(uint32_t value, const uint8_t bits);
+
+/**
+ * Clocks the given amount of bits in from SWDIO, LSB first.
+ *
+ * @param[in] bits how many bits to read, up to 32.
+ *
+ * @return the bits read from the line.
+ */
+static uint32_t swd_read_bits(const uint8_t bits);
+
+/**
+ * Releases SWDIO and clocks a turnaround cycle.
+ */
+static void swd_turnaround(void);
+
+/**
+ * Performs a line reset, followed by a few idle cycles.
+ */
+static void swd_line_reset(void);
+
+/**
+ * Performs a single DP or AP register transfer, retrying on WAIT.
+ *
+ * @param[in] request the request bits, APnDP, RnW, and A[3:2].
+ * @param[in,out] value the value to write, or where to store the value read.
+ *
+ * @return SWD_ACK_OK on success, the last acknowledgement received or
+ *         SWD_RESULT_PARITY_ERROR otherwise.
+ */
+static uint8_t swd_transfer(const uint8_t request, uint32_t *value);
+
+/**
+ * Buffers and runs a transfer list.
+ *
+ * @see BINARY_IO_SWD_ACTION_TRANSFER_LIST
+ */
+static void swd_run_transfer_list(void);
+
+/**
+ * Runs a block read.
+ *
+ * @see BINARY_IO_SWD_ACTION_BLOCK_READ
+ */
+static void swd_run_block_read(void);
+
+/**
+ * Sends a transfer list or block read report to the serial port.
+ *
+ * @param[in] result the last transfer result.
+ * @param[in] completed how many transfers completed successfully.
+ * @param[in] length how many read data bytes are in the terminal buffer.
+ */
+static void swd_report_transfers(const uint8_t result, const uint16_t completed,
+                                 const uint16_t length);
+
+bool swd_parity(uint32_t value) {
+  value ^= value >> 16;
+  value ^= value >> 8;
+  value ^= value >> 4;
+  value ^= value >> 2;
+  value ^= value >> 1;
+
+  return value & 0x01;
+}
+
+void swd_write_bits(uint32_t value, const uint8_t bits) {
+  uint8_t bit;
+
+  for (bit = 0; bit < bits; bit++) {
+    bitbang_write_bit(value & 0x01);
+    value >>= 1;
+  }
+}
+
+uint32_t swd_read_bits(const uint8_t bits) {
+  uint32_t value;
+  uint8_t bit;
+
+  value = 0;
+  for (bit = 0; bit < bits; bit++) {
+    value >>= 1;
+    if (bitbang_read_pin(MOSI)) {
+      value |= 0x80000000;
+    }
+    bitbang_advance_clock_ticks(1);
+  }
+
+  return value >> (32 - bits);
+}
+
+void swd_turnaround(void) {
+  bitbang_read_pin(MOSI);
+  bitbang_advance_clock_ticks(1);
+}
+
+void swd_line_reset(void) {
+  uint8_t cycle;
+
+  for (cycle = 0; cycle < SWD_LINE_RESET_CYCLES; cycle++) {
+    bitbang_write_bit(HIGH);
+  }
+  swd_write_bits(0, SWD_LINE_RESET_IDLE_CYCLES);
+}
+
+uint8_t swd_transfer(const uint8_t request, uint32_t *value) {
+  uint8_t packet;
+  uint8_t acknowledgement;
+  uint8_t retries;
+  uint32_t data;
+
+  packet = SWD_PACKET_START | SWD_PACKET_PARK |
+           ((request & SWD_REQUEST_MASK) << 1);
+  if (swd_parity(request & SWD_REQUEST_MASK)) {
+    packet |= SWD_PACKET_PARITY;
+  }
+
+  retries = swd_state.wait_retries;
+  for (;;) {
+    swd_write_bits(packet, 8);
+    swd_turnaround();
+    acknowledgement = swd_read_bits(3);
+    if (acknowledgement == SWD_ACK_OK) {
+      break;
+    }
+
+    /* No data phase follows a WAIT or FAULT acknowledgement. */
+
+    swd_turnaround();
+    if ((acknowledgement != SWD_ACK_WAIT) || (retries == 0)) {
+      swd_write_bits(0, swd_state.idle_cycles);
+      return acknowledgement;
+    }
+    retries--;
+  }
+
+  if (request & SWD_REQUEST_RNW) {
+    data = swd_read_bits(32);
+    acknowledgement = swd_read_bits(1) != swd_parity(data)
+                          ? SWD_RESULT_PARITY_ERROR
+                          : SWD_ACK_OK;
+    swd_turnaround();
+    if (acknowledgement == SWD_ACK_OK) {
+      *value = data;
+    }
+  } else {
+    swd_turnaround();
+    swd_write_bits(*value, 32);
+    swd_write_bits(swd_parity(*value), 1);
+  }
+
+  swd_write_bits(0, swd_state.idle_cycles);
+
+  return acknowledgement;
+}
+
+void swd_report_transfers(const uint8_t result, const uint16_t completed,
+                          const uint16_t length) {
+  if (result == SWD_ACK_OK) {
+    REPORT_IO_SUCCESS();
+  } else {
+    REPORT_IO_FAILURE();
+  }
+  user_serial_transmit_character(completed >> 8);
+  user_serial_transmit_character(completed & 0xFF);
+  user_serial_transmit_character(result);
+  bp_write_buffer(bus_pirate_configuration.terminal_input, length);
+}
+
+void swd_run_transfer_list(void) {
+  uint8_t *buffer;
+  uint8_t *slot;
+  uint16_t count;
+  uint16_t index;
+  uint16_t length;
+  uint8_t offset;
+  uint8_t result;
+  uint32_t value;
+
+  count = user_serial_read_byte() << 8;
+  count |= user_serial_read_byte();
+  if ((count == 0) || (count > SWD_MAXIMUM_TRANSFERS)) {
+    REPORT_IO_FAILURE();
+    return;
+  }
+
+  buffer = bus_pirate_configuration.terminal_input;
+
+  for (index = 0; index < count; index++) {
+    slot = &buffer[index * SWD_TRANSFER_SLOT_SIZE];
+    slot[0] = user_serial_read_byte() & SWD_REQUEST_MASK;
+    if (!(slot[0] & SWD_REQUEST_RNW)) {
+      for (offset = 1; offset < SWD_TRANSFER_SLOT_SIZE; offset++) {
+        slot[offset] = user_serial_read_byte();
+      }
+    }
+  }
+
+  result = SWD_ACK_OK;
+  for (index = 0; index < count; index++) {
+    slot = &buffer[index * SWD_TRANSFER_SLOT_SIZE];
+    value = ((uint32_t)slot[4] << 24) | ((uint32_t)slot[3] << 16) |
+            ((uint16_t)slot[2] << 8) | slot[1];
+    result = swd_transfer(slot[0], &value);
+    if (result != SWD_ACK_OK) {
+      break;
+    }
+    if (slot[0] & SWD_REQUEST_RNW) {
+      for (offset = 1; offset < SWD_TRANSFER_SLOT_SIZE; offset++) {
+        slot[offset] = value & 0xFF;
+        value >>= 8;
+      }
+    }
+  }
+
+  /* Pack read results at the start of the buffer, in order. */
+
+  length = 0;
+  count = index;
+  for (index = 0; index < count; index++) {
+    slot = &buffer[index * SWD_TRANSFER_SLOT_SIZE];
+    if (slot[0] & SWD_REQUEST_RNW) {
+      for (offset = 1; offset < SWD_TRANSFER_SLOT_SIZE; offset++) {
+        buffer[length++] = slot[offset];
+      }
+    }
+  }
+
+  swd_report_transfers(result, count, length);
+}
+
+void swd_run_block_read(void) {
+  uint8_t *buffer;
+  uint8_t request;
+  uint16_t count;
+  uint16_t index;
+  uint8_t result;
+  uint32_t value;
+
+  request = (user_serial_read_byte() & SWD_REQUEST_MASK) | SWD_REQUEST_RNW;
+  count = user_serial_read_byte() << 8;
+  count |= user_serial_read_byte();
+  if ((count == 0) || (count > SWD_MAXIMUM_BLOCK_READS)) {
+    REPORT_IO_FAILURE();
+    return;
+  }
+
+  buffer = bus_pirate_configuration.terminal_input;
+
+  result = SWD_ACK_OK;
+  for (index = 0; index < count; index++) {
+    result = swd_transfer(request, &value);
+    if (result != SWD_ACK_OK) {
+      break;
+    }
+    *buffer++ = value & 0xFF;
+    *buffer++ = (value >> 8) & 0xFF;
+    *buffer++ = (value >> 16) & 0xFF;
+    *buffer++ = value >> 24;
+  }
+
+  swd_report_transfers(result, index, index * sizeof(uint32_t));
+}
+
+void binary_io_enter_swd_mode(void) {
+  uint8_t input_byte;
+
+  mode_configuration.high_impedance = ON;
+  mode_configuration.lsbEN = OFF;
+  mode_configuration.speed = BITBANG_SPEED_MAXIMUM;
+  bitbang_setup(2, mode_configuration.speed);
+
+  swd_state.wait_retries = SWD_DEFAULT_WAIT_RETRIES;
+  swd_state.idle_cycles = SWD_DEFAULT_IDLE_CYCLES;
+
+  /* SWCLK idles LOW, SWDIO is left HIGH until the host starts a transfer. */
+
+  bitbang_set_clk(LOW);
+  bitbang_set_mosi(HIGH);
+
+  MSG_SWD_MODE_IDENTIFIER;
+
+  for (;;) {
+    input_byte = user_serial_read_byte();
+
+    switch (input_byte >> 4) {
+    case BINARY_IO_SWD_COMMAND_ACTION:
+      switch (input_byte) {
+      case BINARY_IO_SWD_ACTION_EXIT:
+        return;
+
+      case BINARY_IO_SWD_ACTION_VERSION_STRING:
+        MSG_SWD_MODE_IDENTIFIER;
+        break;
+
+      case BINARY_IO_SWD_ACTION_JTAG_TO_SWD:
+        swd_line_reset();
+        swd_write_bits(SWD_JTAG_TO_SWD_SEQUENCE, 16);
+        swd_line_reset();
+        REPORT_IO_SUCCESS();
+        break;
+
+      case BINARY_IO_SWD_ACTION_LINE_RESET:
+        swd_line_reset();
+        REPORT_IO_SUCCESS();
+        break;
+
+      case BINARY_IO_SWD_ACTION_SET_WAIT_RETRIES:
+        swd_state.wait_retries = user_serial_read_byte();
+        REPORT_IO_SUCCESS();
+        break;
+
+      case BINARY_IO_SWD_ACTION_SET_IDLE_CYCLES:
+        swd_state.idle_cycles = user_serial_read_byte();
+        REPORT_IO_SUCCESS();
+        break;
+
+      case BINARY_IO_SWD_ACTION_TRANSFER_LIST:
+        swd_run_transfer_list();
+        break;
+
+      case BINARY_IO_SWD_ACTION_BLOCK_READ:
+        swd_run_block_read();
+        break;
+
+      default:
+        REPORT_IO_FAILURE();
+        break;
+      }
+      break;
+
+    case BINARY_IO_SWD_COMMAND_CONFIGURE_PERIPHERALS:
+      bp_binary_io_peripherals_set(input_byte);
+      REPORT_IO_SUCCESS();
+      break;
+
+#ifdef BUSPIRATEV4
+    case BINARY_IO_SWD_COMMAND_PULLUP_CONTROL:
+      user_serial_transmit_character(bp_binary_io_pullup_control(input_byte));
+      break;
+#endif /* BUSPIRATEV4 */
+
+    case BINARY_IO_SWD_COMMAND_SET_SPEED:
+      mode_configuration.speed = input_byte & 0b00000011;
+      bitbang_setup(2, mode_configuration.speed);
+      REPORT_IO_SUCCESS();
+      break;
+
+    case BINARY_IO_SWD_COMMAND_CONFIGURE:
+      mode_configuration.high_impedance = (input_byte & 0b00001000) ? OFF : ON;
+      bitbang_setup(2, mode_configuration.speed);
+      bitbang_set_clk(LOW);
+      bitbang_set_mosi(HIGH);
+      REPORT_IO_SUCCESS();
+      break;
+
+    default:
+      REPORT_IO_FAILURE();
+      break;
+    }
+  }
+}
+
+#endif /* BP_ENABLE_SWD_SUPPORT */
@@ -0,0 +1,43 @@
+/*
+ * This file is part of the Bus Pirate project
+ * (http://code.google.com/p/the-bus-pirate/).
+ *
+ * Written and maintained by the Bus Pirate project.
+ *
+ * To the extent possible under law, the project has waived all copyright and
+ * related or neighboring rights to Bus Pirate.  This work is published from
+ * United States.
+ *
+ * For details see: http://creativecommons.org/publicdomain/zero/1.0/
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.
+ */
+
+/**
+ * @file swd.h
+ *
+ * @brief ARM Serial Wire Debug protocol handler definition file.
+ *
+ * Serial Wire Debug (SWD) is the two pins debug port found on ARM Cortex-M
+ * microcontrollers, an alternative to JTAG giving access to the same Debug
+ * Port (DP) and Access Port (AP) registers.  The clock is driven on the CLK
+ * pin, whilst the bidirectional data line is on the MOSI pin.
+ */
+
+#ifndef BP_SWD_H
+#define BP_SWD_H
+
+#include "configuration.h"
+
+#ifdef BP_ENABLE_SWD_SUPPORT
+
+/**
+ * @brief Enters binary I/O mode for running SWD transfers directly.
+ */
+void binary_io_enter_swd_mode(void);
+
+#endif /* BP_ENABLE_SWD_SUPPORT */
+
+#endif /* !BP_SWD_H */
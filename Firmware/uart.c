@@ -306,6 +306,11 @@ void uart_setup_execute(void) {
 inline void uart_cleanup(void) { uart2_disable(); }
 
 void uart_run_macro(const uint16_t macro) {
+#ifdef BUSPIRATEV3
+  /* The bridges write to UART1 directly. */
+  user_serial_set_output_buffering(NO);
+#endif /* BUSPIRATEV3 */
+
   switch (macro) {
   case UART_MACRO_MENU:
     BPMSG1203;
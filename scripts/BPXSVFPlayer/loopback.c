@@ -0,0 +1,168 @@
+/*
+ * This file is part of the Bus Pirate project (http://code.google.com/p/the-bus-pirate/).
+ *
+ * Written and maintained by the Bus Pirate project and http://dangerousprototypes.com
+ *
+ * To the extent possible under law, the project has
+ * waived all copyright and related or neighboring rights to Bus Pirate. This
+ * work is published from United States.
+ *
+ * For details see: http://creativecommons.org/publicdomain/zero/1.0/.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef WIN32
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+#include "loopback.h"
+
+#define XSVF_ERROR_NONE 0x00
+
+enum {
+	LOOPBACK_IDLE,          /* no request outstanding */
+	LOOPBACK_LENGTH_HIGH,   /* request sent, waiting for the length */
+	LOOPBACK_LENGTH_LOW,
+	LOOPBACK_DATA,
+	LOOPBACK_END,           /* empty chunk received, draining the ring */
+	LOOPBACK_DONE           /* result sent */
+};
+
+static void loopback_output(loopback_player_t *player, uint8_t value)
+{
+	if (player->output_length < (int)sizeof(player->output)) {
+		player->output[player->output_length++] = value;
+	}
+}
+
+// runs the simulated player up to the current time
+static void loopback_update(loopback_player_t *player)
+{
+	double now = xsvf_stream_clock();
+	int executed;
+
+	player->executed += (now - player->last_update) * player->rate;
+	player->last_update = now;
+	executed = (int)player->executed;
+	if (executed >= player->buffered) {
+		executed = player->buffered;
+		player->executed = 0;
+	} else {
+		player->executed -= executed;
+	}
+	player->buffered -= executed;
+
+	if ((player->state == LOOPBACK_IDLE) &&
+			(player->buffered <= LOOPBACK_PREFETCH_THRESHOLD)) {
+		loopback_output(player, XSVF_STREAM_READY_FOR_DATA);
+		player->state = LOOPBACK_LENGTH_HIGH;
+	}
+	if ((player->state == LOOPBACK_END) && (player->buffered == 0)) {
+		loopback_output(player, XSVF_ERROR_NONE);
+		player->state = LOOPBACK_DONE;
+	}
+}
+
+static int loopback_send(xsvf_link_t *link, const uint8_t *buf, int size)
+{
+	loopback_player_t *player = (loopback_player_t *)link->context;
+	int taken = 0, room;
+
+	loopback_update(player);
+	while (taken < size) {
+		switch (player->state) {
+		case LOOPBACK_LENGTH_HIGH:
+			player->chunk_left = buf[taken++] << 8;
+			player->state = LOOPBACK_LENGTH_LOW;
+			break;
+
+		case LOOPBACK_LENGTH_LOW:
+			player->chunk_left |= buf[taken++];
+			player->state = (player->chunk_left == 0) ? LOOPBACK_END
+					: LOOPBACK_DATA;
+			break;
+
+		case LOOPBACK_DATA:
+			room = LOOPBACK_RING_SIZE - player->buffered;
+			if (room > size - taken) {
+				room = size - taken;
+			}
+			if (room > (int)player->chunk_left) {
+				room = player->chunk_left;
+			}
+			if (room == 0) {
+				// ring full, the rest stays with the host
+				return taken;
+			}
+			taken += room;
+			player->buffered += room;
+			player->chunk_left -= room;
+			if (player->chunk_left == 0) {
+				player->state = LOOPBACK_IDLE;
+			}
+			break;
+
+		default:
+			// nothing was asked for, the data is not taken
+			return taken;
+		}
+	}
+	loopback_update(player);
+	return taken;
+}
+
+static int loopback_receive(xsvf_link_t *link, uint8_t *buf, int size,
+		int timeout_ms)
+{
+	loopback_player_t *player = (loopback_player_t *)link->context;
+	double delay = timeout_ms / 1000.0;
+	int count;
+
+	loopback_update(player);
+	if (player->output_length == 0) {
+		// sleep until the next request or the result is due
+		if (player->state == LOOPBACK_IDLE) {
+			double due = (player->buffered - LOOPBACK_PREFETCH_THRESHOLD)
+					/ player->rate;
+			if (due < delay) {
+				delay = due;
+			}
+		} else if (player->state == LOOPBACK_END) {
+			if (player->buffered / player->rate < delay) {
+				delay = player->buffered / player->rate;
+			}
+		}
+#ifdef WIN32
+		Sleep((DWORD)(delay * 1000) + 1);
+#else
+		usleep((useconds_t)(delay * 1000000) + 1);
+#endif
+		loopback_update(player);
+	}
+
+	count = (player->output_length < size) ? player->output_length : size;
+	memcpy(buf, player->output, count);
+	memmove(player->output, &player->output[count],
+			player->output_length - count);
+	player->output_length -= count;
+	return count;
+}
+
+void loopback_link(xsvf_link_t *link, loopback_player_t *player, double rate)
+{
+	memset(player, 0, sizeof(*player));
+	player->rate = rate;
+	player->last_update = xsvf_stream_clock();
+	player->state = LOOPBACK_IDLE;
+	link->send = loopback_send;
+	link->receive = loopback_receive;
+	link->context = player;
+}
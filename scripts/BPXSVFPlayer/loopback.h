@@ -0,0 +1,51 @@
+/*
+ * This file is part of the Bus Pirate project (http://code.google.com/p/the-bus-pirate/).
+ *
+ * Written and maintained by the Bus Pirate project and http://dangerousprototypes.com
+ *
+ * To the extent possible under law, the project has
+ * waived all copyright and related or neighboring rights to Bus Pirate. This
+ * work is published from United States.
+ *
+ * For details see: http://creativecommons.org/publicdomain/zero/1.0/.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ */
+/*
+ * Loopback XSVF player simulation
+ *
+ * Stands in for a Bus Pirate in XSVF player mode, so the host side of the
+ * stream can be measured without hardware.  It follows the firmware flow
+ * control: data lands in a 4096 bytes ring, a new chunk is asked for as soon
+ * as the ring is at most half full, and bytes are only taken while there is
+ * room for them.  XSVF data is not interpreted, it is just drained from the
+ * ring at a fixed rate standing in for the JTAG execution speed.
+ */
+#ifndef LOOPBACK_H_
+#define LOOPBACK_H_
+
+#include <stdint.h>
+
+#include "xsvfstream.h"
+
+#define LOOPBACK_RING_SIZE          4096
+#define LOOPBACK_PREFETCH_THRESHOLD (LOOPBACK_RING_SIZE / 2)
+#define LOOPBACK_DEFAULT_RATE       20000
+
+typedef struct {
+	double rate;            /* XSVF bytes executed per second */
+	double last_update;
+	double executed;        /* fraction of a byte carried over */
+	int state;
+	int buffered;           /* bytes waiting in the ring */
+	unsigned int chunk_left;
+	uint8_t output[4];
+	int output_length;
+} loopback_player_t;
+
+/* sets up a simulated player executing rate bytes per second */
+void loopback_link(xsvf_link_t *link, loopback_player_t *player, double rate);
+
+#endif
@@ -14,6 +14,9 @@
 
 #include "serial.h"
 #include "buspirate.h"
+#include "xsvfstream.h"
+#include "loopback.h"
+#include "svf.h"
 
 
 #define  JTAG_RESET        0x01
@@ -44,14 +47,41 @@ HANDLE dumphandle;
 #endif
 
 int modem =FALSE;
-int cnt=0;
-uint8_t *bin_buf;
-uint32_t bin_buf_size;
 #define FREE(x) if(x) free(x);
-#define MAX_BUFFER 4096  //255 bytes
+#define MAX_BUFFER XSVF_STREAM_CHUNK_SIZE
+#define REPLY_TIMEOUT 5000  // ms without a byte from the Bus Pirate
 
 //http://www.whereisian.com/files/j-xsvf_002.swf
 
+// .svf files are compiled to XSVF before being played
+static int is_svf(const char *name)
+{
+	size_t length = strlen(name);
+
+	return (length > 4) && !strcasecmp(&name[length - 4], ".svf");
+}
+
+static int compile_svf(const char *name, FILE *out, int repeat)
+{
+	svf_stats_t stats;
+	FILE *svf;
+	int res;
+
+	svf = fopen(name, "r");
+	if (svf == NULL) {
+		printf(" Error opening file\n");
+		return -1;
+	}
+	res = svf_compile(svf, out, repeat, &stats);
+	fclose(svf);
+	if (res < 0) {
+		printf(" Error compiling %s\n", name);
+		return -1;
+	}
+	svf_print_stats(&stats);
+	return 0;
+}
+
 int print_usage(char * appname)
 {
 		//print usage
@@ -60,14 +90,20 @@ int print_usage(char * appname)
 	    printf(" Help Menu\n");
         printf(" Usage:              \n");
 		printf("   %s  -p device -f filename.xsvf -s speed [-x] [-r] \n ",appname);
+		printf("   %s  -l -f filename.xsvf [-R rate] \n ",appname);
+		printf("   %s  -f filename.svf -o filename.xsvf [-n retries] \n ",appname);
 		printf("\n");
 		printf("   Example Usage:   %s -p COM1 -s 115200 -f example.xsvf  \n",appname);
 		printf("\n");
 		printf("           Where: -p device is port e.g.  COM1  \n");
 		printf("                  -s Speed is port Speed  default is 115200 \n");
-		printf("                  -f Filename of XSVF file \n");
+		printf("                  -f Filename of XSVF file, or of SVF file to compile first \n");
+		printf("                  -o Only compile the SVF file to this XSVF file \n");
+		printf("                  -n XC9500 retries in compiled SVF, default is %d \n", SVF_DEFAULT_REPEAT);
 		printf("                  -x Perform a JTAG Chain Scan by sending 0x02 command. -f is optional. \n");
 		printf("                  -r Perform a JTAG Reset  Scan by sending 0x01 command. -f is optional. \n");
+		printf("                  -l Play the file to a simulated Bus Pirate instead of a port \n");
+		printf("                  -R Rate in bytes/s the simulated player executes, default is %d \n", LOOPBACK_DEFAULT_RATE);
 		printf("\n");
 
         printf("-----------------------------------------------------------------------------\n");
@@ -82,17 +118,25 @@ int main(int argc, char** argv)
 	uint8_t buffer[MAX_BUFFER]={0};
 	uint8_t temp[2]={0};  // command buffer
 //	struct stat stbuf;
-	int fd,timeout_counter;
-	int res,c, nparam_bytechunks, bytePointer, readSize;
+	int fd=-1,timeout_counter;
+	int res,c, nparam_bytechunks;
 	long fileSize;
 	FILE *XSVF;
 //	int  xsvf;
-    int timer_out=0;
+	xsvf_link_t link;
+	xsvf_stream_stats_t stats;
+	loopback_player_t player;
 	char *param_port = NULL;
 	char *param_speed = NULL;
 	char *param_XSVF=NULL;
 	char *param_bytechunks=NULL;
+	char *param_rate=NULL;
+	char *rate_end;
+	double rate=LOOPBACK_DEFAULT_RATE;
+	char *param_output=NULL;
+	int  repeat=SVF_DEFAULT_REPEAT;
 	int  jtag_reset=FALSE;
+	int  loopback=FALSE;
     int  chainscan=FALSE;
 
     const char *XSVF_ERROR[]={  "XSVF_ERROR_NONE",
@@ -121,7 +165,7 @@ int main(int argc, char** argv)
 	}
 
 
-	while ((opt = getopt(argc, argv, "s:p:f:rx")) != -1) {
+	while ((opt = getopt(argc, argv, "s:p:f:R:o:n:rxl")) != -1) {
 
 		switch (opt) {
 			case 'p':  // device   eg. com1 com12 etc
@@ -137,6 +181,36 @@ int main(int argc, char** argv)
             case 'x':
                 chainscan=TRUE;
             	break;
+            case 'l':
+                loopback=TRUE;
+                break;
+			case 'o':
+				if (param_output != NULL) {
+					printf(" Output file should be set once \n");
+					exit(-1);
+				}
+				param_output = strdup(optarg);
+				break;
+			case 'n':
+				repeat = atoi(optarg);
+				if ((repeat < 0) || (repeat > 255)) {
+					printf(" Retries should be 0 to 255 \n");
+					exit(-1);
+				}
+				break;
+			case 'R':
+				if (param_rate != NULL) {
+					printf(" Rate should be set once: eg  20000 \n");
+					exit(-1);
+				}
+				param_rate = strdup(optarg);
+				rate = strtod(param_rate, &rate_end);
+				if ((rate_end == param_rate) || (*rate_end != 0) || !(rate > 0)) {
+					printf(" Rate should be a number of bytes/s above 0: eg  20000 \n");
+					print_usage(argv[0]);
+					exit(-1);
+				}
+				break;
 			case 'f':
 				if (param_XSVF != NULL) {
 					printf(" No XSVF file \n");
@@ -163,7 +237,32 @@ int main(int argc, char** argv)
 		}
 	}
 
-	if (param_port==NULL){
+	if (param_rate==NULL) {
+		param_rate=malloc(16);
+		sprintf(param_rate, "%d", LOOPBACK_DEFAULT_RATE);
+	}
+
+	if (param_output!=NULL) {
+		if ((param_XSVF==NULL) || !is_svf(param_XSVF)) {
+			printf(" Need an input svf file to compile \n");
+			exit(-1);
+		}
+		XSVF = fopen(param_output, "wb");
+		if (XSVF == NULL) {
+			printf(" Error opening %s\n", param_output);
+			exit(-1);
+		}
+		res = compile_svf(param_XSVF, XSVF, repeat);
+		fclose(XSVF);
+		if (res < 0) {
+			remove(param_output);
+			exit(-1);
+		}
+		printf(" Wrote %s\n", param_output);
+		return 0;
+	}
+
+	if ((param_port==NULL) && (loopback==FALSE)){
 		printf(" No serial port specified\n");
 		print_usage(argv[0]);
 		exit(-1);
@@ -176,16 +275,18 @@ int main(int argc, char** argv)
 	}
 
 
-	fd = serial_open(param_port);
-	if (fd < 0) {
-		fprintf(stderr, " Error opening serial port\n");
-		return -1;
-	}
+	if (loopback==FALSE) {
+		fd = serial_open(param_port);
+		if (fd < 0) {
+			fprintf(stderr, " Error opening serial port\n");
+			return -1;
+		}
 
-	//setup port and speed
-	serial_setup(fd,(speed_t) atoi(param_speed)); 
+		//setup port and speed
+		serial_setup(fd,(speed_t) atoi(param_speed)); 
+	}
 
-	if (jtag_reset==TRUE){
+	if ((jtag_reset==TRUE) && (loopback==FALSE)){
         printf(" Performing Reset..\n");
         temp[0]=0x01;
         serial_write( fd, (char *)temp, 1 );
@@ -197,7 +298,7 @@ int main(int argc, char** argv)
 	 // Send 0x02 to perform a chain scan
      // Wait for 1 byte, the number of bytes that will be returned
      // Get that many bytes
-	if (chainscan==TRUE) {
+	if ((chainscan==TRUE) && (loopback==FALSE)) {
 		printf(" Performing Chain Scan..\n");
 		temp[0]=0x02;
 		serial_write( fd, (char *)temp, 1 );
@@ -226,146 +327,99 @@ int main(int argc, char** argv)
 	}
 
    if (param_XSVF !=NULL) {
-		//open the XSVF file
-            XSVF = fopen(param_XSVF, "rb");
+		//open the XSVF file, it is read chunk by chunk while playing
+            if (is_svf(param_XSVF)) {
+                XSVF = tmpfile();
+                if ((XSVF == NULL) || (compile_svf(param_XSVF, XSVF, repeat) < 0)) {
+                    exit(-1);
+                }
+            } else {
+                XSVF = fopen(param_XSVF, "rb");
+            }
             if (XSVF == NULL) {
                 printf(" Error opening file\n");
+                exit(-1);
             }
             fseek(XSVF, 0, SEEK_END);
             fileSize = ftell(XSVF);
             fseek(XSVF, 0, SEEK_SET);
-            printf(" File is %lu bytes, ",fileSize);
-
-            bin_buf = (uint8_t*)malloc(fileSize);
-            if (bin_buf == NULL) {
-               printf(" Error allocating %ld bytes of memory\n", (long)fileSize);
-               return -1;
-            }
-            memset(bin_buf, 0, fileSize);
-
-            res = fread(bin_buf, sizeof(uint8_t), fileSize, XSVF);
-            if (res <= 0) {
-                printf(" Error reading file %s \n", param_XSVF);
-            }
-            printf(" Read %i bytes\n",res);
-
-            fclose(XSVF);
-
+            printf(" File is %lu bytes\n",fileSize);
 
 	} else {
 		printf(" No file specified. Need an input xsvf file \n");
 		exit(-1);
 	}
-	printf(" Opening Bus Pirate on %s at %sbps, using XSVF file %s \n", param_port, param_speed,param_XSVF);
-
-	// Enter XSVF Player Mode
-	//Open the port and send 0x03 to enter XSVF player mode
-	printf(" Entering XSVF Player Mode\n");
-	temp[0]=0x03;
-	serial_write( fd, (char *)temp, 1 );
-
-	// Wait for 0xFF, if <0xFF then it is finished or error codes (see below)
-    bytePointer=0; //where we are in the byte buffer array
-    readSize=MAX_BUFFER; //hack this to be a full chunk
-    cnt=0;
-    printf(" Waiting for first data request...");
-	while(1) {
-
-            //wait for reply before sending the next chunks
-			timeout_counter=0;
-			timer_out=0;   // 0 if ok, else -1 if exit
-			while(1) {
-				res= serial_read(fd, (char *)buffer, sizeof(buffer));
-				if(res>0){
-                    printf("ok\n");
-				  // wait for 0xFF and send data, or error
-					if ((buffer[0]!=XSVF_READY_FOR_DATA) || (fileSize==0)) {
-					    c=buffer[0];
-					    if (c==0xFF)
-					         c=8;
-                        printf(" End of operation reply: %s \n",XSVF_ERROR[c]);
-                        switch (buffer[0]) {
-                            case  XSVF_ERROR_NONE :
-                                printf(" Success!\n");
-                                break;
-                            case XSVF_ERROR_UNKNOWN:
-                             printf(" Unknown error: XSVF_ERROR_UNKNOWN \n");
-                                break;
-                            case XSVF_ERROR_TDOMISMATCH:
-                             printf(" Device did not respond as expected: XSVF_ERROR_TDOMISMATCH \n");
-                                break;
-                            case XSVF_ERROR_MAXRETRIES:
-                             printf(" Device did not respond: XSVF_ERROR_MAXRETRIES \n");
-                                break;
-                            case XSVF_ERROR_ILLEGALCMD :
-                             printf(" Unknown XSVF command: XSVF_ERROR_ILLEGALCMD \n");
-                                break;
-                            case XSVF_ERROR_ILLEGALSTATE:
-                             printf(" Unknown JTAG state: XSVF_ERROR_ILLEGALSTATE \n");
-                                break;
-                            case XSVF_ERROR_DATAOVERFLOW :
-                             printf(" Error, data overflow: XSVF_ERROR_DATAOVERFLOW \n");
-                                break;
-                            case XSVF_ERROR_LAST:
-                             printf(" Some other error I don't remember, probably isn't active: XSVF_ERROR_LAST \n");
-                                break;
-                            case XSVF_READY_FOR_DATA:
-                                if (fileSize==0) {
-                                    printf(" End of file reached. \n");
-                                } else {
-									printf(" Programmer says more data: XSVF_READY_FOR_DATA \n");
-                                }
-                                break;
-                            default:
-                             printf(" Unknown error\n ");
-
-                         }
-
-                     }
-                     break; //break loop and send data
-				}else{
-					printf("\n Waiting for reply...");
-				//	Sleep(1);
-					timeout_counter++;
-					if(timeout_counter > 4){
-						printf("\n No reply.... Quitting.\n ");
-						timeout_counter=0;
-						timer_out=-1;
-						break;
-					}
-				}
-			}
-            if (fileSize==0) {
-			       break;
-			}
 
-            if (timer_out==-1)
-                break;
-            //send data
-            if(fileSize<MAX_BUFFER){
-                readSize=fileSize;
-            }
-			//send to bp
-			temp[0]=(readSize>>8);
-			temp[1]=readSize;
-			cnt=cnt+readSize;
+	if (loopback==TRUE) {
+		printf(" Simulating a Bus Pirate executing %s bytes/s, using XSVF file %s \n", param_rate, param_XSVF);
+		loopback_link(&link, &player, rate);
+	} else {
+		printf(" Opening Bus Pirate on %s at %sbps, using XSVF file %s \n", param_port, param_speed,param_XSVF);
+
+		// Enter XSVF Player Mode
+		//Open the port and send 0x03 to enter XSVF player mode
+		printf(" Entering XSVF Player Mode\n");
+		temp[0]=0x03;
+		serial_write( fd, (char *)temp, 1 );
+		xsvf_stream_serial_link(&link, fd);
+	}
 
-			printf(" Sending %i Bytes (%04X)...",readSize, cnt);
-			serial_write( fd, (char *)temp,2 );
-			serial_write( fd, (char *) &bin_buf[bytePointer],readSize );
-			bytePointer=bytePointer+readSize;//start 1 chunk in next itme
-			fileSize=fileSize-readSize; //deincrement the remaining byte count
+	// Wait for 0xFF and answer with the next chunk, a byte other than 0xFF
+	// is the end of operation reply (see below)
+	printf(" Waiting for first data request...\n");
+	res = xsvf_stream_play(&link, XSVF, REPLY_TIMEOUT, &stats);
+	fclose(XSVF);
+
+	if (res == XSVF_STREAM_TIMEOUT) {
+		printf(" No reply.... Quitting.\n ");
+	} else if (res == XSVF_STREAM_IO_ERROR) {
+		printf(" Error talking to the Bus Pirate\n");
+	} else {
+		if (res <= XSVF_ERROR_LAST) {
+			printf(" End of operation reply: %s \n",XSVF_ERROR[res]);
+		} else {
+			printf(" End of operation reply: %02X \n",res);
+		}
+		switch (res) {
+			case  XSVF_ERROR_NONE :
+				printf(" Success!\n");
+				break;
+			case XSVF_ERROR_UNKNOWN:
+			 printf(" Unknown error: XSVF_ERROR_UNKNOWN \n");
+				break;
+			case XSVF_ERROR_TDOMISMATCH:
+			 printf(" Device did not respond as expected: XSVF_ERROR_TDOMISMATCH \n");
+				break;
+			case XSVF_ERROR_MAXRETRIES:
+			 printf(" Device did not respond: XSVF_ERROR_MAXRETRIES \n");
+				break;
+			case XSVF_ERROR_ILLEGALCMD :
+			 printf(" Unknown XSVF command: XSVF_ERROR_ILLEGALCMD \n");
+				break;
+			case XSVF_ERROR_ILLEGALSTATE:
+			 printf(" Unknown JTAG state: XSVF_ERROR_ILLEGALSTATE \n");
+				break;
+			case XSVF_ERROR_DATAOVERFLOW :
+			 printf(" Error, data overflow: XSVF_ERROR_DATAOVERFLOW \n");
+				break;
+			case XSVF_ERROR_LAST:
+			 printf(" Some other error I don't remember, probably isn't active: XSVF_ERROR_LAST \n");
+				break;
+			default:
+			 printf(" Unknown error\n ");
 
+		 }
 	}
+	xsvf_stream_print_stats(&stats);
 
     printf(" Thank you for playing! :-)\n\n");
 #ifdef WIN32
-    fclose(XSVF);
 	FREE(param_port);
  	FREE(param_speed);
     FREE(param_bytechunks);
     FREE(param_XSVF);
-    FREE( bin_buf);
+    FREE(param_rate);
+    FREE(param_output);
 #endif
     return 0;
  }  //end main()
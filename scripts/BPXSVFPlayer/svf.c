@@ -0,0 +1,937 @@
+/*
+ * This file is part of the Bus Pirate project (http://code.google.com/p/the-bus-pirate/).
+ *
+ * Written and maintained by the Bus Pirate project and http://dangerousprototypes.com
+ *
+ * To the extent possible under law, the project has
+ * waived all copyright and related or neighboring rights to Bus Pirate. This
+ * work is published from United States.
+ *
+ * For details see: http://creativecommons.org/publicdomain/zero/1.0/.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <ctype.h>
+
+#include "svf.h"
+
+/* XSVF commands, as numbered by the firmware player */
+#define XCOMPLETE        0
+#define XTDOMASK         1
+#define XSIR             2
+#define XSDR             3
+#define XRUNTEST         4
+#define XREPEAT          7
+#define XSDRSIZE         8
+#define XSDRTDO          9
+#define XSDRB            12
+#define XSDRC            13
+#define XSDRE            14
+#define XSDRTDOB         15
+#define XSDRTDOC         16
+#define XSDRTDOE         17
+#define XSTATE           18
+#define XENDIR           19
+#define XENDDR           20
+#define XSIR2            21
+#define XWAIT            23
+
+#define XTAPSTATE_RESET     0x00
+#define XTAPSTATE_RUNTEST   0x01
+#define XTAPSTATE_SELECTDR  0x02
+#define XTAPSTATE_CAPTUREDR 0x03
+#define XTAPSTATE_SHIFTDR   0x04
+#define XTAPSTATE_EXIT1DR   0x05
+#define XTAPSTATE_PAUSEDR   0x06
+#define XTAPSTATE_EXIT2DR   0x07
+#define XTAPSTATE_UPDATEDR  0x08
+#define XTAPSTATE_SELECTIR  0x09
+#define XTAPSTATE_CAPTUREIR 0x0A
+#define XTAPSTATE_SHIFTIR   0x0B
+#define XTAPSTATE_EXIT1IR   0x0C
+#define XTAPSTATE_PAUSEIR   0x0D
+#define XTAPSTATE_EXIT2IR   0x0E
+#define XTAPSTATE_UPDATEIR  0x0F
+
+#define XENDXR_RUNTEST   0
+#define XENDXR_PAUSE     1
+
+#define SVF_MAX_TOKENS   64
+
+static const char *svf_state_names[] = {
+	"RESET", "IDLE", "DRSELECT", "DRCAPTURE", "DRSHIFT", "DREXIT1",
+	"DRPAUSE", "DREXIT2", "DRUPDATE", "IRSELECT", "IRCAPTURE", "IRSHIFT",
+	"IREXIT1", "IRPAUSE", "IREXIT2", "IRUPDATE", NULL
+};
+
+/* bit i is the i-th bit shifted, i.e. the LSB of the SVF hex value is bit 0 */
+typedef struct {
+	long bits;
+	uint8_t *data;
+} svf_vector_t;
+
+typedef struct {
+	long length;
+	svf_vector_t tdi;
+	svf_vector_t tdo;
+	svf_vector_t mask;
+	int check;              /* TDO given in the last statement */
+} svf_scan_t;
+
+typedef struct {
+	svf_vector_t tdi;
+	svf_vector_t tdo;
+	svf_vector_t mask;      /* all zeroes where nothing is checked */
+	int check;
+	int end_state;
+	long runtest;
+} svf_shift_t;
+
+typedef struct {
+	FILE *out;
+	int line;
+	svf_stats_t *stats;
+
+	/* SVF side state */
+	svf_scan_t sdr, sir, hdr, hir, tdr, tir;
+	int end_dr, end_ir;
+	int run_state, run_end_state;
+
+	/* shift held back for merging or folding a RUNTEST into it */
+	int pending;
+	int pending_ir;
+	svf_shift_t shift;
+
+	/* what the player holds */
+	int tap_state;
+	int player_end_dr, player_end_ir;
+	long player_sdr_size;
+	long player_runtest;
+	int mask_valid, expected_valid;
+	svf_vector_t player_mask, player_expected;
+} svf_compiler_t;
+
+static void vector_resize(svf_vector_t *vector, long bits)
+{
+	long old_bytes = (vector->bits + 7) / 8;
+	long bytes = (bits + 7) / 8;
+
+	if (bytes != old_bytes) {
+		vector->data = realloc(vector->data, bytes ? bytes : 1);
+		if (vector->data == NULL) {
+			fprintf(stderr, " Out of memory\n");
+			exit(-1);
+		}
+		if (bytes > old_bytes) {
+			memset(&vector->data[old_bytes], 0, bytes - old_bytes);
+		}
+	}
+	// keep the bits past the end cleared, so vectors compare bytewise
+	if (bits < vector->bits && (bits & 7)) {
+		vector->data[bits / 8] &= (1 << (bits & 7)) - 1;
+	}
+	vector->bits = bits;
+}
+
+static inline int vector_get(const svf_vector_t *vector, long bit)
+{
+	return (vector->data[bit >> 3] >> (bit & 7)) & 1;
+}
+
+static inline void vector_set(svf_vector_t *vector, long bit, int value)
+{
+	if (value) {
+		vector->data[bit >> 3] |= 1 << (bit & 7);
+	} else {
+		vector->data[bit >> 3] &= ~(1 << (bit & 7));
+	}
+}
+
+static void vector_fill(svf_vector_t *vector, long bits, int value)
+{
+	long i;
+
+	vector_resize(vector, 0);
+	vector_resize(vector, bits);
+	for (i = 0; value && i < bits; i++) {
+		vector_set(vector, i, 1);
+	}
+}
+
+static void vector_slice(svf_vector_t *to, const svf_vector_t *from,
+		long start, long bits)
+{
+	long i;
+
+	vector_resize(to, bits);
+	for (i = 0; i < bits; i++) {
+		vector_set(to, i, vector_get(from, start + i));
+	}
+}
+
+static void vector_append(svf_vector_t *to, const svf_vector_t *from)
+{
+	long start = to->bits, i;
+
+	vector_resize(to, start + from->bits);
+	for (i = 0; i < from->bits; i++) {
+		vector_set(to, start + i, vector_get(from, i));
+	}
+}
+
+static int vector_is_zero(const svf_vector_t *vector)
+{
+	long i;
+
+	for (i = 0; i < (vector->bits + 7) / 8; i++) {
+		if (vector->data[i]) {
+			return 0;
+		}
+	}
+	return 1;
+}
+
+static int vector_is_ones(const svf_vector_t *vector)
+{
+	long i;
+
+	for (i = 0; i < vector->bits; i++) {
+		if (!vector_get(vector, i)) {
+			return 0;
+		}
+	}
+	return 1;
+}
+
+static int vector_equal(const svf_vector_t *a, const svf_vector_t *b)
+{
+	return (a->bits == b->bits) &&
+			!memcmp(a->data, b->data, (a->bits + 7) / 8);
+}
+
+static void vector_free(svf_vector_t *vector)
+{
+	free(vector->data);
+	vector->data = NULL;
+	vector->bits = 0;
+}
+
+static int svf_error(svf_compiler_t *compiler, const char *message,
+		const char *token)
+{
+	fprintf(stderr, " SVF line %d: %s%s%s\n", compiler->line, message,
+			token ? " " : "", token ? token : "");
+	return -1;
+}
+
+/*
+ * XSVF output
+ */
+
+static void emit_byte(svf_compiler_t *compiler, uint8_t value)
+{
+	fputc(value, compiler->out);
+	compiler->stats->bytes++;
+}
+
+static void emit_u32(svf_compiler_t *compiler, uint32_t value)
+{
+	emit_byte(compiler, value >> 24);
+	emit_byte(compiler, value >> 16);
+	emit_byte(compiler, value >> 8);
+	emit_byte(compiler, value);
+}
+
+// lenval order: most significant byte first, bit 0 is the LSB of the last byte
+static void emit_vector(svf_compiler_t *compiler, const svf_vector_t *vector)
+{
+	long i;
+
+	for (i = (vector->bits + 7) / 8 - 1; i >= 0; i--) {
+		emit_byte(compiler, vector->data[i]);
+	}
+}
+
+static void emit_runtest(svf_compiler_t *compiler, long runtest)
+{
+	if (runtest == compiler->player_runtest) {
+		compiler->stats->dropped_settings++;
+		return;
+	}
+	emit_byte(compiler, XRUNTEST);
+	emit_u32(compiler, runtest);
+	compiler->player_runtest = runtest;
+}
+
+static void emit_end_state(svf_compiler_t *compiler, int ir, int state)
+{
+	int *player_state = ir ? &compiler->player_end_ir : &compiler->player_end_dr;
+
+	if (state == *player_state) {
+		compiler->stats->dropped_settings++;
+		return;
+	}
+	emit_byte(compiler, ir ? XENDIR : XENDDR);
+	emit_byte(compiler, (state == XTAPSTATE_RUNTEST) ? XENDXR_RUNTEST
+			: XENDXR_PAUSE);
+	*player_state = state;
+}
+
+static void emit_sdr_size(svf_compiler_t *compiler, long bits)
+{
+	if (bits == compiler->player_sdr_size) {
+		compiler->stats->dropped_settings++;
+		return;
+	}
+	emit_byte(compiler, XSDRSIZE);
+	emit_u32(compiler, bits);
+	compiler->player_sdr_size = bits;
+	// the player keeps the old lengths, neither can be compared against now
+	compiler->mask_valid = 0;
+	compiler->expected_valid = 0;
+}
+
+static void emit_mask(svf_compiler_t *compiler, const svf_vector_t *mask)
+{
+	if (compiler->mask_valid && vector_equal(mask, &compiler->player_mask)) {
+		compiler->stats->dropped_settings++;
+		return;
+	}
+	emit_byte(compiler, XTDOMASK);
+	emit_vector(compiler, mask);
+	vector_slice(&compiler->player_mask, mask, 0, mask->bits);
+	compiler->mask_valid = 1;
+}
+
+static void emit_wait(svf_compiler_t *compiler, int wait_state, int end_state,
+		long usec)
+{
+	emit_byte(compiler, XWAIT);
+	emit_byte(compiler, wait_state);
+	emit_byte(compiler, end_state);
+	emit_u32(compiler, usec);
+	compiler->tap_state = end_state;
+}
+
+static int emit_ir_shift(svf_compiler_t *compiler, svf_shift_t *shift)
+{
+	if (shift->tdi.bits > SVF_PLAYER_MAX_LEN * 8) {
+		return svf_error(compiler, "instruction register too long for the player", NULL);
+	}
+	if (shift->check) {
+		// XSIR has no compare, the Xilinx tools drop it as well
+		compiler->stats->dropped_compares++;
+	}
+	emit_end_state(compiler, 1, shift->end_state);
+	emit_runtest(compiler, shift->runtest);
+	if (shift->tdi.bits < 256) {
+		emit_byte(compiler, XSIR);
+		emit_byte(compiler, shift->tdi.bits);
+	} else {
+		emit_byte(compiler, XSIR2);
+		emit_byte(compiler, shift->tdi.bits >> 8);
+		emit_byte(compiler, shift->tdi.bits);
+	}
+	emit_vector(compiler, &shift->tdi);
+	compiler->tap_state = shift->runtest ? XTAPSTATE_RUNTEST : shift->end_state;
+	return 0;
+}
+
+// splits a data register scan over several XSDRB/XSDRC/XSDRE commands
+static int emit_long_dr_shift(svf_compiler_t *compiler, svf_shift_t *shift)
+{
+	svf_vector_t chunk = {0, NULL};
+	long max_bits = SVF_PLAYER_MAX_LEN * 8;
+	long start, bits;
+	int command;
+
+	if (shift->check && !vector_is_ones(&shift->mask)) {
+		return svf_error(compiler, "masked compare too long for the player", NULL);
+	}
+	emit_end_state(compiler, 0, shift->end_state);
+	for (start = 0; start < shift->tdi.bits; start += bits) {
+		bits = shift->tdi.bits - start;
+		if (bits > max_bits) {
+			bits = max_bits;
+		}
+		emit_sdr_size(compiler, bits);
+		if (start == 0) {
+			command = XSDRB;
+		} else if (start + bits == shift->tdi.bits) {
+			command = XSDRE;
+		} else {
+			command = XSDRC;
+		}
+		if (shift->check) {
+			command += XSDRTDOB - XSDRB;
+		}
+		emit_byte(compiler, command);
+		vector_slice(&chunk, &shift->tdi, start, bits);
+		emit_vector(compiler, &chunk);
+		if (shift->check) {
+			vector_slice(&chunk, &shift->tdo, start, bits);
+			emit_vector(compiler, &chunk);
+			vector_slice(&compiler->player_expected, &chunk, 0, bits);
+			compiler->expected_valid = 1;
+		}
+	}
+	vector_free(&chunk);
+	compiler->tap_state = shift->end_state;
+	if (shift->runtest) {
+		emit_wait(compiler, XTAPSTATE_RUNTEST, XTAPSTATE_RUNTEST, shift->runtest);
+	}
+	return 0;
+}
+
+static int emit_dr_shift(svf_compiler_t *compiler, svf_shift_t *shift)
+{
+	long bits = shift->tdi.bits;
+
+	if (bits > SVF_PLAYER_MAX_LEN * 8) {
+		return emit_long_dr_shift(compiler, shift);
+	}
+
+	emit_end_state(compiler, 0, shift->end_state);
+	emit_sdr_size(compiler, bits);
+
+	if (!shift->check) {
+		if (shift->runtest && compiler->mask_valid && compiler->expected_valid &&
+				vector_is_zero(&compiler->player_mask)) {
+			// the mask already loaded ignores TDO, XSDR can wait as well
+			emit_runtest(compiler, shift->runtest);
+			emit_byte(compiler, XSDR);
+			emit_vector(compiler, &shift->tdi);
+			compiler->tap_state = XTAPSTATE_RUNTEST;
+			return 0;
+		}
+		emit_byte(compiler, XSDRE);
+		emit_vector(compiler, &shift->tdi);
+		compiler->tap_state = shift->end_state;
+		if (shift->runtest) {
+			emit_wait(compiler, XTAPSTATE_RUNTEST, XTAPSTATE_RUNTEST,
+					shift->runtest);
+		}
+		return 0;
+	}
+
+	emit_mask(compiler, &shift->mask);
+	emit_runtest(compiler, shift->runtest);
+	if (compiler->expected_valid &&
+			vector_equal(&shift->tdo, &compiler->player_expected)) {
+		// same expected value as the last compare, skip the TDO data
+		compiler->stats->dropped_compares++;
+		emit_byte(compiler, XSDR);
+		emit_vector(compiler, &shift->tdi);
+	} else {
+		emit_byte(compiler, XSDRTDO);
+		emit_vector(compiler, &shift->tdi);
+		emit_vector(compiler, &shift->tdo);
+		vector_slice(&compiler->player_expected, &shift->tdo, 0, bits);
+		compiler->expected_valid = 1;
+	}
+	compiler->tap_state = shift->runtest ? XTAPSTATE_RUNTEST : shift->end_state;
+	return 0;
+}
+
+static int flush_pending(svf_compiler_t *compiler)
+{
+	int res;
+
+	if (!compiler->pending) {
+		return 0;
+	}
+	compiler->pending = 0;
+	if (compiler->pending_ir) {
+		res = emit_ir_shift(compiler, &compiler->shift);
+	} else {
+		res = emit_dr_shift(compiler, &compiler->shift);
+	}
+	return res;
+}
+
+/*
+ * SVF input
+ */
+
+// reads one statement up to ';', comments removed, returns 0 at end of file
+static int read_statement(svf_compiler_t *compiler, FILE *svf, char **text,
+		size_t *size)
+{
+	size_t length = 0;
+	int c, comment = 0, slash = 0;
+
+	while ((c = fgetc(svf)) != EOF) {
+		if (c == '\n') {
+			compiler->line++;
+			comment = 0;
+		}
+		if (comment) {
+			continue;
+		}
+		if (c == '!' || (c == '/' && slash)) {
+			comment = 1;
+			slash = 0;
+			if (c == '/') {
+				length--;
+			}
+			continue;
+		}
+		slash = (c == '/');
+		// grown before the terminator too, the first statement may be empty
+		if (length + 2 > *size) {
+			*size = *size ? *size * 2 : 4096;
+			*text = realloc(*text, *size);
+			if (*text == NULL) {
+				fprintf(stderr, " Out of memory\n");
+				exit(-1);
+			}
+		}
+		if (c == ';') {
+			(*text)[length] = 0;
+			return 1;
+		}
+		(*text)[length++] = isspace(c) ? ' ' : toupper(c);
+	}
+	if (length && *text) {
+		(*text)[length] = 0;
+		while (length && (*text)[length - 1] == ' ') {
+			length--;
+		}
+		if (length) {
+			svf_error(compiler, "statement not terminated by ;", NULL);
+		}
+	}
+	return 0;
+}
+
+// splits a statement into words, a (...) group is one word without spaces,
+// returns -1 when there are more than SVF_MAX_TOKENS words
+static int tokenize(const char *text, char *words, char **tokens)
+{
+	int count = 0;
+
+	while (*text) {
+		if (*text == ' ') {
+			text++;
+			continue;
+		}
+		if (count == SVF_MAX_TOKENS) {
+			return -1;
+		}
+		tokens[count++] = words;
+		if (*text == '(') {
+			while (*text && *text != ')') {
+				if (*text != ' ') {
+					*words++ = *text;
+				}
+				text++;
+			}
+			if (*text) {
+				*words++ = *text++;
+			}
+		} else {
+			while (*text && *text != ' ' && *text != '(') {
+				*words++ = *text++;
+			}
+		}
+		*words++ = 0;
+	}
+	return count;
+}
+
+static int parse_state(const char *name)
+{
+	int i;
+
+	for (i = 0; svf_state_names[i]; i++) {
+		if (!strcmp(name, svf_state_names[i])) {
+			return i;
+		}
+	}
+	return -1;
+}
+
+static int parse_hex(svf_compiler_t *compiler, const char *token, long bits,
+		svf_vector_t *vector)
+{
+	size_t digits = strlen(token);
+	long bit = 0;
+	int value, i;
+
+	if (digits < 2 || token[0] != '(' || token[digits - 1] != ')') {
+		return svf_error(compiler, "bad vector", token);
+	}
+	vector_fill(vector, bits, 0);
+	// the last digit holds bits 0 to 3
+	for (i = digits - 2; i > 0; i--) {
+		if (!isxdigit((unsigned char)token[i])) {
+			return svf_error(compiler, "bad vector", token);
+		}
+		value = isdigit((unsigned char)token[i]) ? token[i] - '0'
+				: token[i] - 'A' + 10;
+		for (int j = 0; j < 4; j++, bit++) {
+			if (bit < bits && (value & (1 << j))) {
+				vector_set(vector, bit, 1);
+			}
+		}
+	}
+	return 0;
+}
+
+// parses "length [TDI (..)] [TDO (..)] [MASK (..)] [SMASK (..)]"
+static int parse_scan(svf_compiler_t *compiler, char **tokens, int count,
+		svf_scan_t *scan)
+{
+	char *end;
+	long length;
+	int i, has_tdi = 0;
+
+	if (count < 2) {
+		return svf_error(compiler, "missing length", NULL);
+	}
+	length = strtol(tokens[1], &end, 10);
+	if (*end || length < 0) {
+		return svf_error(compiler, "bad length", tokens[1]);
+	}
+	for (i = 2; i + 1 < count; i += 2) {
+		has_tdi |= !strcmp(tokens[i], "TDI");
+	}
+	if (i != count) {
+		return svf_error(compiler, "missing vector after", tokens[count - 1]);
+	}
+	if (length != scan->length) {
+		// TDI is only carried over for the same length, MASK resets to all ones
+		if (!has_tdi && length) {
+			return svf_error(compiler, "TDI required for a new length", NULL);
+		}
+		vector_fill(&scan->tdi, length, 0);
+		vector_fill(&scan->mask, length, 1);
+		scan->length = length;
+	}
+
+	scan->check = 0;
+	for (i = 2; i + 1 < count; i += 2) {
+		if (!strcmp(tokens[i], "TDI")) {
+			if (parse_hex(compiler, tokens[i + 1], length, &scan->tdi) < 0) {
+				return -1;
+			}
+		} else if (!strcmp(tokens[i], "TDO")) {
+			if (parse_hex(compiler, tokens[i + 1], length, &scan->tdo) < 0) {
+				return -1;
+			}
+			scan->check = 1;
+		} else if (!strcmp(tokens[i], "MASK")) {
+			if (parse_hex(compiler, tokens[i + 1], length, &scan->mask) < 0) {
+				return -1;
+			}
+		} else if (strcmp(tokens[i], "SMASK")) {
+			return svf_error(compiler, "unknown scan parameter", tokens[i]);
+		}
+	}
+	if (!scan->check) {
+		vector_fill(&scan->tdo, length, 0);
+	}
+	return 0;
+}
+
+// appends a scan part, with what is checked and what is not
+static void append_part(svf_shift_t *shift, const svf_scan_t *scan)
+{
+	svf_vector_t zero = {0, NULL};
+
+	vector_append(&shift->tdi, &scan->tdi);
+	vector_append(&shift->tdo, &scan->tdo);
+	if (scan->check && !vector_is_zero(&scan->mask)) {
+		vector_append(&shift->mask, &scan->mask);
+		shift->check = 1;
+	} else {
+		vector_fill(&zero, scan->length, 0);
+		vector_append(&shift->mask, &zero);
+		vector_free(&zero);
+	}
+}
+
+static int do_shift(svf_compiler_t *compiler, char **tokens, int count, int ir)
+{
+	svf_scan_t *scan = ir ? &compiler->sir : &compiler->sdr;
+	svf_shift_t shift;
+	int pause = ir ? XTAPSTATE_PAUSEIR : XTAPSTATE_PAUSEDR;
+	int check;
+
+	if (parse_scan(compiler, tokens, count, scan) < 0) {
+		return -1;
+	}
+	compiler->stats->shifts++;
+
+	memset(&shift, 0, sizeof(shift));
+	append_part(&shift, ir ? &compiler->hir : &compiler->hdr);
+	append_part(&shift, scan);
+	append_part(&shift, ir ? &compiler->tir : &compiler->tdr);
+	shift.end_state = ir ? compiler->end_ir : compiler->end_dr;
+	if (scan->check && !shift.check) {
+		// every TDO bit is masked out, nothing to compare
+		compiler->stats->dropped_compares++;
+	}
+	if (shift.tdi.bits == 0) {
+		vector_free(&shift.tdi);
+		vector_free(&shift.tdo);
+		vector_free(&shift.mask);
+		return 0;
+	}
+
+	// a shift left in pause is continued by the next one, without update
+	check = shift.check || compiler->shift.check;
+	if (compiler->pending && (compiler->pending_ir == ir) &&
+			(compiler->shift.end_state == pause) &&
+			(compiler->shift.runtest == 0) &&
+			(!check || (compiler->shift.tdi.bits + shift.tdi.bits <=
+			 SVF_PLAYER_MAX_LEN * 8))) {
+		vector_append(&compiler->shift.tdi, &shift.tdi);
+		vector_append(&compiler->shift.tdo, &shift.tdo);
+		vector_append(&compiler->shift.mask, &shift.mask);
+		compiler->shift.check = check;
+		compiler->shift.end_state = shift.end_state;
+		compiler->stats->merged_shifts++;
+		vector_free(&shift.tdi);
+		vector_free(&shift.tdo);
+		vector_free(&shift.mask);
+		return 0;
+	}
+
+	if (flush_pending(compiler) < 0) {
+		return -1;
+	}
+	vector_free(&compiler->shift.tdi);
+	vector_free(&compiler->shift.tdo);
+	vector_free(&compiler->shift.mask);
+	compiler->shift = shift;
+	compiler->pending = 1;
+	compiler->pending_ir = ir;
+	return 0;
+}
+
+static int do_end_state(svf_compiler_t *compiler, char **tokens, int count,
+		int ir)
+{
+	int state;
+
+	state = (count == 2) ? parse_state(tokens[1]) : -1;
+	if (state != XTAPSTATE_RUNTEST &&
+			state != (ir ? XTAPSTATE_PAUSEIR : XTAPSTATE_PAUSEDR)) {
+		return svf_error(compiler, "end state not supported by the player",
+				(count == 2) ? tokens[1] : NULL);
+	}
+	if (ir) {
+		compiler->end_ir = state;
+	} else {
+		compiler->end_dr = state;
+	}
+	return 0;
+}
+
+static int do_runtest(svf_compiler_t *compiler, char **tokens, int count)
+{
+	double usec = 0, value;
+	long wait;
+	char *end;
+	int i = 1, state;
+
+	if (i < count && (state = parse_state(tokens[i])) >= 0) {
+		compiler->run_state = compiler->run_end_state = state;
+		i++;
+	}
+	while (i < count) {
+		if (!strcmp(tokens[i], "ENDSTATE") && i + 1 < count) {
+			compiler->run_end_state = parse_state(tokens[i + 1]);
+			if (compiler->run_end_state < 0) {
+				return svf_error(compiler, "bad state", tokens[i + 1]);
+			}
+			i += 2;
+		} else if (!strcmp(tokens[i], "MAXIMUM") && i + 2 < count) {
+			i += 3;
+		} else if (i + 1 < count) {
+			value = strtod(tokens[i], &end);
+			if (*end) {
+				return svf_error(compiler, "bad RUNTEST count", tokens[i]);
+			}
+			if (!strcmp(tokens[i + 1], "SEC")) {
+				value *= 1000000;
+			} else if (strcmp(tokens[i + 1], "TCK") &&
+					strcmp(tokens[i + 1], "SCK")) {
+				return svf_error(compiler, "bad RUNTEST unit", tokens[i + 1]);
+			}
+			// clocks count as microseconds, as the player waits at 1MHz
+			if (value > usec) {
+				usec = value;
+			}
+			i += 2;
+		} else {
+			return svf_error(compiler, "bad RUNTEST", tokens[i]);
+		}
+	}
+
+	wait = (long)usec + (usec > (long)usec);
+
+	if (compiler->pending && (compiler->run_state == XTAPSTATE_RUNTEST) &&
+			(compiler->run_end_state == XTAPSTATE_RUNTEST)) {
+		// the player waits in Run-Test/Idle right after the shift
+		compiler->shift.runtest += wait;
+		return 0;
+	}
+	if (flush_pending(compiler) < 0) {
+		return -1;
+	}
+	if (wait == 0 && compiler->run_state == compiler->tap_state &&
+			compiler->run_end_state == compiler->tap_state) {
+		return 0;
+	}
+	emit_wait(compiler, compiler->run_state, compiler->run_end_state,
+			wait);
+	return 0;
+}
+
+static int do_state(svf_compiler_t *compiler, char **tokens, int count)
+{
+	int i, state;
+
+	if (flush_pending(compiler) < 0) {
+		return -1;
+	}
+	for (i = 1; i < count; i++) {
+		state = parse_state(tokens[i]);
+		if (state < 0) {
+			return svf_error(compiler, "bad state", tokens[i]);
+		}
+		if (state == compiler->tap_state &&
+				(state == XTAPSTATE_RESET || state == XTAPSTATE_RUNTEST)) {
+			compiler->stats->dropped_states++;
+			continue;
+		}
+		emit_byte(compiler, XSTATE);
+		emit_byte(compiler, state);
+		compiler->tap_state = state;
+	}
+	return 0;
+}
+
+static int do_statement(svf_compiler_t *compiler, char **tokens, int count)
+{
+	const char *command = tokens[0];
+
+	if (!strcmp(command, "SDR")) {
+		return do_shift(compiler, tokens, count, 0);
+	} else if (!strcmp(command, "SIR")) {
+		return do_shift(compiler, tokens, count, 1);
+	} else if (!strcmp(command, "HDR")) {
+		return parse_scan(compiler, tokens, count, &compiler->hdr);
+	} else if (!strcmp(command, "HIR")) {
+		return parse_scan(compiler, tokens, count, &compiler->hir);
+	} else if (!strcmp(command, "TDR")) {
+		return parse_scan(compiler, tokens, count, &compiler->tdr);
+	} else if (!strcmp(command, "TIR")) {
+		return parse_scan(compiler, tokens, count, &compiler->tir);
+	} else if (!strcmp(command, "ENDDR")) {
+		return do_end_state(compiler, tokens, count, 0);
+	} else if (!strcmp(command, "ENDIR")) {
+		return do_end_state(compiler, tokens, count, 1);
+	} else if (!strcmp(command, "RUNTEST")) {
+		return do_runtest(compiler, tokens, count);
+	} else if (!strcmp(command, "STATE")) {
+		return do_state(compiler, tokens, count);
+	} else if (!strcmp(command, "FREQUENCY")) {
+		return 0;
+	} else if (!strcmp(command, "TRST")) {
+		// the player has no TRST line, ABSENT/OFF/Z are what it does anyway
+		if (count != 2) {
+			return svf_error(compiler, "bad TRST", NULL);
+		}
+		if (strcmp(tokens[1], "ABSENT") && strcmp(tokens[1], "OFF") &&
+				strcmp(tokens[1], "Z")) {
+			return svf_error(compiler, "TRST not supported by the player",
+					tokens[1]);
+		}
+		return 0;
+	}
+	return svf_error(compiler, "command not supported", command);
+}
+
+int svf_compile(FILE *svf, FILE *xsvf, int max_repeat, svf_stats_t *stats)
+{
+	svf_compiler_t compiler;
+	svf_scan_t *scans[] = { &compiler.sdr, &compiler.sir, &compiler.hdr,
+			&compiler.hir, &compiler.tdr, &compiler.tir };
+	char *text = NULL, *words = NULL, *tokens[SVF_MAX_TOKENS];
+	size_t size = 0;
+	int count, res = 0;
+
+	memset(stats, 0, sizeof(*stats));
+	memset(&compiler, 0, sizeof(compiler));
+	compiler.out = xsvf;
+	compiler.line = 1;
+	compiler.stats = stats;
+	compiler.end_dr = compiler.end_ir = XTAPSTATE_RUNTEST;
+	compiler.run_state = compiler.run_end_state = XTAPSTATE_RUNTEST;
+	// as set up by xsvfInitialize()
+	compiler.tap_state = XTAPSTATE_RESET;
+	compiler.player_end_dr = compiler.player_end_ir = XTAPSTATE_RUNTEST;
+
+	if (max_repeat) {
+		emit_byte(&compiler, XREPEAT);
+		emit_byte(&compiler, max_repeat);
+	}
+	while (read_statement(&compiler, svf, &text, &size)) {
+		words = realloc(words, 2 * strlen(text) + 1);
+		if (words == NULL) {
+			fprintf(stderr, " Out of memory\n");
+			exit(-1);
+		}
+		count = tokenize(text, words, tokens);
+		if (count < 0) {
+			res = svf_error(&compiler, "too many words in statement", NULL);
+			break;
+		}
+		if (count == 0) {
+			continue;
+		}
+		stats->statements++;
+		res = do_statement(&compiler, tokens, count);
+		if (res < 0) {
+			break;
+		}
+	}
+	if (res == 0) {
+		res = flush_pending(&compiler);
+	}
+	emit_byte(&compiler, XCOMPLETE);
+
+	free(text);
+	free(words);
+	vector_free(&compiler.shift.tdi);
+	vector_free(&compiler.shift.tdo);
+	vector_free(&compiler.shift.mask);
+	vector_free(&compiler.player_mask);
+	vector_free(&compiler.player_expected);
+	for (count = 0; count < 6; count++) {
+		vector_free(&scans[count]->tdi);
+		vector_free(&scans[count]->tdo);
+		vector_free(&scans[count]->mask);
+	}
+	return res;
+}
+
+void svf_print_stats(const svf_stats_t *stats)
+{
+	printf(" Compiled %i SVF statements into %ld XSVF bytes\n",
+			stats->statements, stats->bytes);
+	printf(" %i shifts, %i merged, %i compares without TDO data or dropped,\n",
+			stats->shifts, stats->merged_shifts, stats->dropped_compares);
+	printf(" %i redundant state moves and %i repeated settings left out\n",
+			stats->dropped_states, stats->dropped_settings);
+}
@@ -0,0 +1,64 @@
+/*
+ * This file is part of the Bus Pirate project (http://code.google.com/p/the-bus-pirate/).
+ *
+ * Written and maintained by the Bus Pirate project and http://dangerousprototypes.com
+ *
+ * To the extent possible under law, the project has
+ * waived all copyright and related or neighboring rights to Bus Pirate. This
+ * work is published from United States.
+ *
+ * For details see: http://creativecommons.org/publicdomain/zero/1.0/.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ */
+/*
+ * SVF to XSVF compiler
+ *
+ * Translates Serial Vector Format files into the XSVF stream understood by
+ * the player in the Bus Pirate firmware, without going through the Xilinx
+ * svf2xsvf tools.  The compiler keeps track of the player state and only
+ * emits what changes it:
+ *
+ *  - XSDRSIZE, XTDOMASK, XENDIR/XENDDR and XRUNTEST are only sent when the
+ *    value differs from the one the player already holds, and a RUNTEST
+ *    following a shift is folded into the shift itself;
+ *  - scans whose TDO is all don't-care are sent without a compare, and a
+ *    compare against the expected value already loaded skips the TDO data;
+ *  - shifts ending in a pause state are merged with the following shift
+ *    of the same register, since no update happens in between;
+ *  - STATE moves to RESET or IDLE when the TAP is already there are dropped.
+ *
+ * Data registers longer than the player buffer are split into XSDRB, XSDRC
+ * and XSDRE chunks.
+ */
+#ifndef SVF_H_
+#define SVF_H_
+
+#include <stdio.h>
+
+/* lenval MAX_LEN of the firmware player, in bytes */
+#define SVF_PLAYER_MAX_LEN         50
+/* XC9500 retries, the svf2xsvf default */
+#define SVF_DEFAULT_REPEAT         16
+
+typedef struct {
+	int statements;         /* SVF statements read */
+	long bytes;             /* XSVF bytes written */
+	int shifts;             /* SIR/SDR statements */
+	int merged_shifts;      /* shifts appended to the previous one */
+	int dropped_compares;   /* TDO compares sent without TDO data or dropped */
+	int dropped_states;     /* redundant STATE moves */
+	int dropped_settings;   /* XSDRSIZE/XTDOMASK/XRUNTEST/XENDxR not resent */
+} svf_stats_t;
+
+/*
+ * Compiles the SVF file into XSVF, max_repeat being the XREPEAT count.
+ * Returns 0 on success, -1 after printing the offending line otherwise.
+ */
+int svf_compile(FILE *svf, FILE *xsvf, int max_repeat, svf_stats_t *stats);
+
+void svf_print_stats(const svf_stats_t *stats);
+
+#endif
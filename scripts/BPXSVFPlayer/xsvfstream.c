@@ -0,0 +1,228 @@
+/*
+ * This file is part of the Bus Pirate project (http://code.google.com/p/the-bus-pirate/).
+ *
+ * Written and maintained by the Bus Pirate project and http://dangerousprototypes.com
+ *
+ * To the extent possible under law, the project has
+ * waived all copyright and related or neighboring rights to Bus Pirate. This
+ * work is published from United States.
+ *
+ * For details see: http://creativecommons.org/publicdomain/zero/1.0/.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+
+#include "serial.h"
+#include "xsvfstream.h"
+
+typedef struct {
+	uint8_t data[2 + XSVF_STREAM_CHUNK_SIZE];
+	int length;     /* header included */
+} xsvf_chunk_t;
+
+#ifdef WIN32
+
+double xsvf_stream_clock(void)
+{
+	LARGE_INTEGER frequency, counter;
+
+	QueryPerformanceFrequency(&frequency);
+	QueryPerformanceCounter(&counter);
+	return (double)counter.QuadPart / (double)frequency.QuadPart;
+}
+
+/* the port is opened for blocking I/O with read timeouts, keep using that */
+static int serial_link_send(xsvf_link_t *link, const uint8_t *buf, int size)
+{
+	return serial_write((int)(intptr_t)link->context, (char *)buf, size);
+}
+
+static int serial_link_receive(xsvf_link_t *link, uint8_t *buf, int size,
+		int timeout_ms)
+{
+	(void)timeout_ms;
+	return serial_read((int)(intptr_t)link->context, (char *)buf, size);
+}
+
+#else
+
+double xsvf_stream_clock(void)
+{
+	struct timeval now;
+
+	gettimeofday(&now, NULL);
+	return now.tv_sec + now.tv_usec / 1000000.0;
+}
+
+static int serial_link_send(xsvf_link_t *link, const uint8_t *buf, int size)
+{
+	int res;
+
+	res = write((int)(intptr_t)link->context, buf, size);
+	if (res < 0) {
+		return ((errno == EAGAIN) || (errno == EINTR)) ? 0 : -1;
+	}
+	return res;
+}
+
+static int serial_link_receive(xsvf_link_t *link, uint8_t *buf, int size,
+		int timeout_ms)
+{
+	int fd = (int)(intptr_t)link->context;
+	fd_set readable;
+	struct timeval timeout;
+	int res;
+
+	FD_ZERO(&readable);
+	FD_SET(fd, &readable);
+	timeout.tv_sec = timeout_ms / 1000;
+	timeout.tv_usec = (timeout_ms % 1000) * 1000;
+	res = select(fd + 1, &readable, NULL, NULL, &timeout);
+	if (res <= 0) {
+		return ((res == 0) || (errno == EINTR)) ? 0 : -1;
+	}
+	res = read(fd, buf, size);
+	if (res < 0) {
+		return ((errno == EAGAIN) || (errno == EINTR)) ? 0 : -1;
+	}
+	return res;
+}
+
+#endif
+
+void xsvf_stream_serial_link(xsvf_link_t *link, int fd)
+{
+#ifndef WIN32
+	// writes must return instead of waiting for the player to make room
+	fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+#endif
+	link->send = serial_link_send;
+	link->receive = serial_link_receive;
+	link->context = (void *)(intptr_t)fd;
+}
+
+// reads and frames the next chunk, an empty chunk marks the end of the file
+static int xsvf_stream_stage(FILE *file, xsvf_chunk_t *chunk)
+{
+	size_t size;
+
+	size = fread(&chunk->data[2], 1, XSVF_STREAM_CHUNK_SIZE, file);
+	if (ferror(file)) {
+		return -1;
+	}
+	chunk->data[0] = (uint8_t)(size >> 8);
+	chunk->data[1] = (uint8_t)size;
+	chunk->length = (int)size + 2;
+	return 0;
+}
+
+int xsvf_stream_play(xsvf_link_t *link, FILE *file, int timeout_ms,
+		xsvf_stream_stats_t *stats)
+{
+	xsvf_chunk_t chunks[2];
+	xsvf_chunk_t *staged = &chunks[0];
+	xsvf_chunk_t *sending = &chunks[1];
+	uint8_t reply[64];
+	int sent = 0, pending_requests = 0;
+	int res, i;
+	double start, now, requested = 0, last_activity;
+
+	memset(stats, 0, sizeof(*stats));
+	sending->length = 0;
+	if (xsvf_stream_stage(file, staged) < 0) {
+		return XSVF_STREAM_IO_ERROR;
+	}
+
+	start = last_activity = xsvf_stream_clock();
+	while (1) {
+		// answer the request with the chunk already waiting
+		if ((sent == sending->length) && (pending_requests > 0)) {
+			xsvf_chunk_t *swap = sending;
+
+			pending_requests--;
+			sending = staged;
+			staged = swap;
+			sent = 0;
+			requested = last_activity;
+			if (sending->length > 2) {
+				stats->bytes_sent += sending->length - 2;
+				stats->chunks++;
+				printf(" Sending %i Bytes (%04lX)...\n", sending->length - 2,
+						stats->bytes_sent);
+			} else {
+				printf(" End of file reached.\n");
+			}
+		}
+
+		// push as much of the current chunk as the link takes right now
+		if (sent < sending->length) {
+			res = link->send(link, &sending->data[sent], sending->length - sent);
+			if (res < 0) {
+				return XSVF_STREAM_IO_ERROR;
+			}
+			if (res > 0) {
+				last_activity = xsvf_stream_clock();
+				if (sent == 0) {
+					stats->stall_time += last_activity - requested;
+				}
+			}
+			sent += res;
+			if (sent == sending->length) {
+				// read ahead while the player works through this chunk
+				if (xsvf_stream_stage(file, staged) < 0) {
+					return XSVF_STREAM_IO_ERROR;
+				}
+			}
+		}
+
+		now = xsvf_stream_clock();
+		res = link->receive(link, reply, sizeof(reply),
+				(sent < sending->length) ? 1 : 50);
+		if (res < 0) {
+			return XSVF_STREAM_IO_ERROR;
+		}
+		if (sent == sending->length) {
+			stats->wait_time += xsvf_stream_clock() - now;
+		} else {
+			stats->flow_time += xsvf_stream_clock() - now;
+		}
+		if (res == 0) {
+			if ((xsvf_stream_clock() - last_activity) * 1000 > timeout_ms) {
+				stats->elapsed = last_activity - start;
+				return XSVF_STREAM_TIMEOUT;
+			}
+			continue;
+		}
+		last_activity = xsvf_stream_clock();
+
+		for (i = 0; i < res; i++) {
+			if (reply[i] != XSVF_STREAM_READY_FOR_DATA) {
+				stats->elapsed = last_activity - start;
+				return reply[i];
+			}
+			pending_requests++;
+		}
+	}
+}
+
+void xsvf_stream_print_stats(const xsvf_stream_stats_t *stats)
+{
+	printf(" Sent %ld bytes in %i chunks in %.3f s", stats->bytes_sent,
+			stats->chunks, stats->elapsed);
+	if (stats->elapsed > 0) {
+		printf(", %.0f bytes/s", stats->bytes_sent / stats->elapsed);
+	}
+	printf("\n");
+	printf(" Player stalled on the host for %.3f s, host waited on the player for %.3f s\n",
+			stats->stall_time, stats->wait_time);
+	printf(" Player ring full for %.3f s\n", stats->flow_time);
+}
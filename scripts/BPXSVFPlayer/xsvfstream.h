@@ -0,0 +1,76 @@
+/*
+ * This file is part of the Bus Pirate project (http://code.google.com/p/the-bus-pirate/).
+ *
+ * Written and maintained by the Bus Pirate project and http://dangerousprototypes.com
+ *
+ * To the extent possible under law, the project has
+ * waived all copyright and related or neighboring rights to Bus Pirate. This
+ * work is published from United States.
+ *
+ * For details see: http://creativecommons.org/publicdomain/zero/1.0/.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ */
+/*
+ * Pipelined XSVF stream sender
+ *
+ * The player on the Bus Pirate asks for data by sending 0xFF, the host then
+ * answers with a 16 bits big endian length followed by that many bytes of
+ * XSVF data.  A zero length chunk tells the player there is no more data, and
+ * any other byte coming from the player is the final result code.
+ *
+ * The sender keeps the next chunk read from the file and framed before the
+ * player asks for it, so the request is answered straight away while the
+ * player is still executing the data it already holds.  Writes never block:
+ * if the link cannot take the whole chunk the sender keeps listening to the
+ * player, so a result code sent in the middle of a chunk is never missed.
+ */
+#ifndef XSVFSTREAM_H_
+#define XSVFSTREAM_H_
+
+#include <stdio.h>
+#include <stdint.h>
+
+#define XSVF_STREAM_CHUNK_SIZE     4096
+#define XSVF_STREAM_READY_FOR_DATA 0xFF
+
+/* the player did not answer in time */
+#define XSVF_STREAM_TIMEOUT        -1
+/* the link failed or the file could not be read */
+#define XSVF_STREAM_IO_ERROR       -2
+
+typedef struct xsvf_link {
+	/* sends up to size bytes without blocking, returns the count accepted */
+	int (*send)(struct xsvf_link *link, const uint8_t *buf, int size);
+	/* waits up to timeout_ms for data, returns the count read, 0 on timeout */
+	int (*receive)(struct xsvf_link *link, uint8_t *buf, int size, int timeout_ms);
+	void *context;
+} xsvf_link_t;
+
+typedef struct {
+	long bytes_sent;        /* XSVF payload bytes handed to the link */
+	int chunks;             /* data chunks sent, the end marker excluded */
+	double elapsed;         /* seconds from entering the player to the result */
+	double stall_time;      /* seconds from data requests to their answers */
+	double wait_time;       /* seconds the host waited for a data request */
+	double flow_time;       /* seconds the player refused data, ring full */
+} xsvf_stream_stats_t;
+
+/* seconds elapsed since an arbitrary origin, for measuring intervals */
+double xsvf_stream_clock(void);
+
+/* wraps an open serial port into a link */
+void xsvf_stream_serial_link(xsvf_link_t *link, int fd);
+
+/*
+ * Streams the whole file to the player, the player must already be in XSVF
+ * mode.  Returns the player result code, or one of the XSVF_STREAM_* errors.
+ */
+int xsvf_stream_play(xsvf_link_t *link, FILE *file, int timeout_ms,
+		xsvf_stream_stats_t *stats);
+
+void xsvf_stream_print_stats(const xsvf_stream_stats_t *stats);
+
+#endif